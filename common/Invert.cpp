@@ -2,7 +2,21 @@
 #include "InvertUI.h"
 #include "InvertScripting.h"
 #include "InvertRegistry.h"
+#include "InvertKernels.h"
+#include "InvertPipeline.h"
+#include "InvertTiles.h"
+#include "InvertPorts.h"
+#include "InvertSelection.h"
+#include "InvertPreview.h"
+#include "InvertPyramid.h"
+#include "InvertDisplay.h"
+#include "InvertBuffers.h"
+#include "InvertTiming.h"
+#include "InvertArena.h"
+#include "InvertGovernor.h"
+#include "PIProgressSuite.h"
 #include "FilterBigDocument.h"
+#include <string.h>
 #include <time.h>
 #include "Logger.h"
 #include "Timer.h"
@@ -23,10 +37,13 @@ void DoContinue(void);
 void DoFinish(void);
 
 void DoFilter(void);
+int32 InvertTiles(const TilePlan& plan, Governor& governor, Boolean& interleaved);
+void SetupKernels(void);
+Boolean OutputIsInterleaved(void);
 void CalcProxyScaleFactor(void);
 void ConvertRGBColorToMode(const int16 imageMode, FilterColor& color);
-void ScaleRect(VRect& destination, const int16 num, const int16 den);
-void ShrinkRect(VRect& destination, const int16 width, const int16 height);
+void ScaleRect(VRect& destination, const int32 num, const int32 den);
+void ShrinkRect(VRect& destination, const int32 width, const int32 height);
 void CopyRect(VRect& destination, const VRect& source);
 void LockHandles(void);
 void UnlockHandles(void);
@@ -34,13 +51,29 @@ void CreateParametersHandle(void);
 void InitParameters(void);
 void CreateDataHandle(void);
 void InitData(void);
-void InvertRectangle(void* data,
-	int32 dataRowBytes,
-	void* mask,
-	int32 maskRowBytes,
-	VRect tileRect,
-	uint8 color,
-	int32 depth);
+
+// UnlockHandles once PluginMain is done with a selector, thrown out of or not
+class AutoUnlockHandles
+{
+public:
+	explicit AutoUnlockHandles(Boolean locked) : unlock(locked) { }
+	~AutoUnlockHandles()
+	{
+		if (unlock)
+			UnlockHandles();
+	}
+
+private:
+	Boolean unlock;
+};
+
+// DeleteProxyBuffer however the dialog ends
+class AutoProxyBuffers
+{
+public:
+	AutoProxyBuffers() { }
+	~AutoProxyBuffers() { DeleteProxyBuffer(); }
+};
 
 DLLExport MACPASCAL void PluginMain(const int16 selector,
 	FilterRecordPtr filterRecord,
@@ -62,6 +95,8 @@ DLLExport MACPASCAL void PluginMain(const int16 selector,
 		gDataHandle = data;
 		gResult = result;
 
+		AutoUnlockHandles unlockHandles(selector != filterSelectorAbout);
+
 		if (selector == filterSelectorAbout)
 		{
 			sSPBasic = ((AboutRecord*)gFilterRecord)->sSPBasic;
@@ -98,9 +133,6 @@ DLLExport MACPASCAL void PluginMain(const int16 selector,
 			break;
 		}
 
-		if (selector != filterSelectorAbout)
-			UnlockHandles();
-
 		logIt.Write(timeIt.GetElapsed(), true);
 
 	}
@@ -140,36 +172,43 @@ void DoPrepare(void)
 		if (*gResult == noErr)
 		{
 			LockHandles();
-			InitParameters();
-			InitData();
+			if (*gResult == noErr)
+			{
+				InitParameters();
+				InitData();
+			}
 		}
 	}
 
-	gFilterRecord->bufferSpace = 0;
+	// without the handles there is no gData to plan into
+	if (*gResult != noErr)
+		return;
 
-	VRect filterRect = GetFilterRect();
-	int32 tileHeight = filterRect.bottom - filterRect.top;
-	int32 tileWidth = filterRect.right - filterRect.left;
-	if (tileHeight > 256)
-		tileHeight = 256;
-	if (tileWidth > 256)
-		tileWidth = 256;
+	// plan with everything the host offers, then ask for what the plan uses
+	// and leave the rest to Photoshop
+	int64 available = gFilterRecord->maxSpace64 > 0 ? gFilterRecord->maxSpace64 : gFilterRecord->maxSpace;
 
-	int32 tileSize = tileHeight * tileWidth;
-	int32 planes = gFilterRecord->planes;
-	if (gFilterRecord->maskData != NULL)
-		planes++;
-	planes *= 2;
+	TilePlan plan;
+	PlanTiles(plan, GetFilterRect(), available);
 
-	int32 totalSize = tileSize * planes;
-	if (gFilterRecord->maxSpace > totalSize)
-		gFilterRecord->maxSpace = totalSize;
+	int64 needed = plan.hostBytes + plan.bufferBytes;
+	if (needed < available)
+		available = needed;
+
+	gData->spaceBudget = available;
+	gData->arenaBudget = plan.bufferBytes;
+	gFilterRecord->maxSpace64 = available;
+	gFilterRecord->maxSpace = available > INT32_MAX ? INT32_MAX : (int32)available;
+	gFilterRecord->bufferSpace64 = plan.bufferBytes;
+	gFilterRecord->bufferSpace = plan.bufferBytes > INT32_MAX ? INT32_MAX : (int32)plan.bufferBytes;
 }
 
 void DoStart(void)
 {
 	LockHandles();
 
+	SetupKernels();
+
 	ReadRegistryParameters();
 
 	int16 lastDisposition = gParams->disposition;
@@ -180,14 +219,29 @@ void DoStart(void)
 	Boolean displayDialog;
 	OSErr err = ReadScriptParameters(&displayDialog);
 
+	// the counters DeleteProxyBuffer logs cover this dialog only
+	ResetBufferCounters();
+	ResetPreviewTiming();
 	if (!err && displayDialog)
+	{
+		// the proxy buffers and the source cache live for the whole dialog
+		AutoProxyBuffers proxyBuffers;
 		isOK = DoUI();
+	}
 
 	gData->queryForParameters = false;
 
 	if (isOK)
 	{
+		// the tile slots come out of one buffer that DoFinish frees, the
+		// host skips DoFinish when we fail. Two slots each with their mask
+		// on its own line need a little more than the plan.
+		AutoArena arena;
+		if (gData->arenaBudget > 0)
+			OpenArena(gData->arenaBudget + 4 * kArenaAlignment);
 		DoFilter();
+		if (*gResult == noErr)
+			arena.Keep();
 	}
 	else
 	{
@@ -214,98 +268,200 @@ void DoFinish(void)
 	LockHandles();
 	WriteScriptParameters();
 	WriteRegistryParameters();
+	LogArenaUsage();
+	CloseArena();
+
+#ifdef _DEBUG
+	// every buffer and lock of the run should be back with the host by now
+	CheckBufferBalance();
+#endif
 }
 
 void DoFilter(void)
 {
-	srand((unsigned)time(NULL));
+	if (RunInvertChannelPorts())
+		return;
 
-	int32 tileHeight = gFilterRecord->outTileHeight;
-	int32 tileWidth = gFilterRecord->outTileWidth;
+	gFilterRecord->inputRate = (int32)1 << 16;
+	gFilterRecord->maskRate = (int32)1 << 16;
 
-	if (tileWidth == 0 || tileHeight == 0)
+	// with a selection, look at the mask alone first and then only fetch
+	// the image where something is selected
+	VRect area = GetFilterRect();
+	SelectionMap selection;
+	Boolean probed = gFilterRecord->haveMask && !gParams->ignoreSelection && gParams->percent > 0;
+	if (probed)
 	{
-		*gResult = filterBadParameters;
-		return;
+		*gResult = ProbeSelection(selection, gData->spaceBudget);
+		if (*gResult != noErr) return;
+		area = selection.bounds;
 	}
 
-	VRect filterRect = GetFilterRect();
-	int32 rectWidth = filterRect.right - filterRect.left;
-	int32 rectHeight = filterRect.bottom - filterRect.top;
-
-	CreateInvertBuffer(tileWidth, tileHeight);
+	// the host tile geometry is known now, plan inside what the host has
+	// free, never more than DoPrepare asked for, and plan the rest of the
+	// area again whenever the governor says that has changed
+	Governor governor;
+	StartGovernor(governor, area, gData->spaceBudget);
 
-	int32 tilesVert = (tileHeight - 1 + rectHeight) / tileHeight;
-	int32 tilesHoriz = (tileWidth - 1 + rectWidth) / tileWidth;
+	Boolean interleaved = true;
+	VRect rest = area;
+	while (rest.top < rest.bottom)
+	{
+		TilePlan plan;
+		PlanTiles(plan, rest, governor.budget);
+		if (probed)
+			CoverTiles(plan, selection);
+		GovernorPlanned(governor, plan);
+
+		// the slots are free between plans, a plan without them gives them back
+		if (!plan.pipeline)
+			CloseArena();
+
+		int32 stoppedAt;
+		if (!plan.pipeline || !RunInvertPipeline(plan, governor, stoppedAt))
+			stoppedAt = InvertTiles(plan, governor, interleaved);
+		if (*gResult != noErr || stoppedAt >= TileCount(plan))
+			return;
+
+		rest.top = GetTileRect(plan, stoppedAt).top;
+	}
+}
 
-	gFilterRecord->inputRate = (int32)1 << 16;
-	gFilterRecord->maskRate = (int32)1 << 16;
+//-------------------------------------------------------------------------------
+//
+// InvertTiles
+//
+// The serial filter loop. Returns the tile it stopped at, before asking for
+// it, when the governor wants a new plan, and TileCount when it is done or
+// *gResult is set. interleaved goes false, for this plan and the ones after
+// it, once the host shows an all planes layout we don't walk.
+//
+//-------------------------------------------------------------------------------
+int32 InvertTiles(const TilePlan& plan, Governor& governor, Boolean& interleaved)
+{
+	int32 tiles = TileCount(plan);
 
-	int32 progressTotal = tilesVert * tilesHoriz;
-	int32 progressDone = 0;
+	VRect noRect = { 0, 0, 0, 0 };
 
-	for (int32 vertTile = 0; vertTile < tilesVert; vertTile++)
+	for (int32 tile = 0; tile < tiles; tile++)
 	{
-		for (int32 horizTile = 0; horizTile < tilesHoriz; horizTile++)
+		if (GovernorWantsReplan(governor, plan, tile))
+			return tile;
+
+		VRect inRect = GetTileRect(plan, tile);
+		Coverage coverage = GetTileCoverage(plan, tile);
+
+		if (coverage == coverageEmpty)
 		{
-			UpdateInvertBuffer(tileWidth, tileHeight);
+			GovernorProgress(governor, plan, tile);
+			continue;
+		}
+
+		SetInRect(inRect);
 
-			filterRect = GetFilterRect();
-			VRect inRect = GetInRect();
+		SetOutRect(inRect);
 
-			inRect.top = vertTile * tileHeight + filterRect.top;
-			inRect.left = horizTile * tileWidth + filterRect.left;
-			inRect.bottom = inRect.top + tileHeight;
-			inRect.right = inRect.left + tileWidth;
+		// fully selected tiles don't need the mask
+		if (gFilterRecord->haveMask)
+		{
+			SetMaskRect(coverage == coverageFull ? noRect : inRect);
+		}
 
-			if (inRect.bottom > rectHeight)
-				inRect.bottom = rectHeight;
-			if (inRect.right > rectWidth)
-				inRect.right = rectWidth;
+		Boolean allPlanes = plan.allPlanes && interleaved;
+		if (allPlanes)
+		{
+			gFilterRecord->outLoPlane = gFilterRecord->inLoPlane = 0;
+			gFilterRecord->outHiPlane = gFilterRecord->inHiPlane = gFilterRecord->planes - 1;
 
-			SetInRect(inRect);
+			*gResult = gFilterRecord->advanceState();
+			if (*gResult != noErr) return tiles;
 
-			SetOutRect(inRect);
+			void* maskData = coverage == coverageFull ? NULL : gFilterRecord->maskData;
 
-			if (gFilterRecord->haveMask)
+			if (OutputIsInterleaved())
 			{
-				SetMaskRect(inRect);
+				InvertRectangle(gFilterRecord->outData,
+					gFilterRecord->outRowBytes,
+					maskData,
+					gFilterRecord->maskRowBytes,
+					GetOutRect(),
+					gFilterRecord->depth,
+					gFilterRecord->planes,
+					1);
 			}
+			else
+			{
+				// a layout we don't walk, redo this tile and the rest one plane at a time
+				allPlanes = interleaved = false;
+			}
+		}
 
+		if (!allPlanes)
+		{
 			for (int16 plane = 0; plane < gFilterRecord->planes; plane++)
 			{
 				gFilterRecord->outLoPlane = gFilterRecord->inLoPlane = plane;
 				gFilterRecord->outHiPlane = gFilterRecord->inHiPlane = plane;
 
 				*gResult = gFilterRecord->advanceState();
-				if (*gResult != noErr) return;
-
-				uint8 color = 255;
-				int16 expectedPlanes = CSPlanesFromMode(gFilterRecord->imageMode,
-					0);
+				if (*gResult != noErr) return tiles;
 
-				if (plane < expectedPlanes)
-					color = gData->color[plane];
+				void* maskData = coverage == coverageFull ? NULL : gFilterRecord->maskData;
 
 				InvertRectangle(gFilterRecord->outData,
 					gFilterRecord->outRowBytes,
-					gFilterRecord->maskData,
+					maskData,
 					gFilterRecord->maskRowBytes,
 					GetOutRect(),
-					color,
-					gFilterRecord->depth);
+					gFilterRecord->depth,
+					1,
+					1);
 			}
+		}
 
-			gFilterRecord->progressProc(++progressDone, progressTotal);
+		GovernorProgress(governor, plan, tile);
 
-			if (gFilterRecord->abortProc())
-			{
-				*gResult = userCanceledErr;
-				return;
-			}
+		if (gFilterRecord->abortProc())
+		{
+			*gResult = userCanceledErr;
+			return tiles;
 		}
 	}
-	DeleteInvertBuffer();
+	return tiles;
+}
+
+void SetupKernels(void)
+{
+	SelectInvertKernels(gKernels, DetectInvertISA());
+
+#ifdef _DEBUG
+	if (!VerifyInvertKernels(gKernels))
+	{
+		Logger logIt("Invert");
+		logIt.Write(InvertISAName(gKernels.isa), false);
+		logIt.Write(" kernels do not match scalar, falling back", true);
+		SelectInvertKernels(gKernels, isaScalar);
+	}
+#endif
+}
+
+//-------------------------------------------------------------------------------
+//
+// OutputIsInterleaved
+//
+// After an all planes advanceState the out buffer should hold the planes
+// side by side for each pixel. Hosts that report another layout, or none at
+// all, get the one plane at a time path.
+//
+//-------------------------------------------------------------------------------
+Boolean OutputIsInterleaved(void)
+{
+	int32 sampleBytes = gFilterRecord->depth / 8;
+	if (sampleBytes == 0)
+		sampleBytes = 1;
+
+	return gFilterRecord->outPlaneBytes == sampleBytes &&
+		gFilterRecord->outColumnBytes == sampleBytes * gFilterRecord->planes;
 }
 
 void InvertRectangle(void* data,
@@ -313,48 +469,58 @@ void InvertRectangle(void* data,
 	void* mask,
 	int32 maskRowBytes,
 	VRect tileRect,
-	uint8 color,
-	int32 depth)
+	int32 depth,
+	int32 planes,
+	int32 step)
 {
+	InvertRectangle(*gParams, data, dataRowBytes, mask, maskRowBytes, tileRect, depth, planes, step);
+}
 
-	uint8* pixel = (uint8*)data;
-	uint16* bigPixel = (uint16*)data;
-	float* fPixel = (float*)data;
-	uint8* maskPixel = (uint8*)mask;
+// the preview renderer passes a copy of the parameters, the dialog may be
+// changing gParams underneath it
+void InvertRectangle(const Parameters& params,
+	void* data,
+	int32 dataRowBytes,
+	void* mask,
+	int32 maskRowBytes,
+	VRect tileRect,
+	int32 depth,
+	int32 planes,
+	int32 step)
+{
 
 	int32 rectHeight = tileRect.bottom - tileRect.top;
 	int32 rectWidth = tileRect.right - tileRect.left;
 
-	for (int32 pixelY = 0; pixelY < rectHeight; pixelY++)
-	{
-		for (int32 pixelX = 0; pixelX < rectWidth; pixelX++)
-		{
-
-			bool leaveItAlone = false;
-			if (maskPixel != NULL && !(*maskPixel) && !gParams->ignoreSelection)
-				leaveItAlone = true;
+	if (params.percent <= 0)
+		return;
 
-			if (!leaveItAlone)
-			{
-				if (depth == 32)
-					*fPixel = 1.0 - *fPixel;
-				else if (depth == 16)
-					*bigPixel = UINT16_MAX - *bigPixel;
-				else
-					*pixel = UINT8_MAX - *pixel;
-			}
-			pixel++;
-			bigPixel++;
-			fPixel++;
-			if (maskPixel != NULL)
-				maskPixel++;
-		}
-		pixel += (dataRowBytes - rectWidth);
-		bigPixel += (dataRowBytes / 2 - rectWidth);
-		fPixel += (dataRowBytes / 4 - rectWidth);
-		if (maskPixel != NULL)
-			maskPixel += (maskRowBytes - rectWidth);
+	// below 100 percent each pixel is inverted with that probability, decided
+	// by its document position so tiles, planes and the proxy all agree
+	InvertPick pick;
+	InvertPick* picking = NULL;
+	if (params.percent < 100)
+	{
+		pick.seed = (uint32)params.seed;
+		pick.threshold = InvertThreshold(params.percent);
+		pick.left = tileRect.left * step;
+		pick.top = tileRect.top * step;
+		pick.step = step;
+		picking = &pick;
 	}
+
+	bool masked = mask != NULL && !params.ignoreSelection;
+	InvertTileProc invertTile = GetInvertTileProc(depth, masked);
+
+	invertTile(gKernels,
+		(uint8*)data,
+		dataRowBytes,
+		(const uint8*)mask,
+		maskRowBytes,
+		rectWidth,
+		rectHeight,
+		planes,
+		picking);
 }
 
 void CreateParametersHandle(void)
@@ -370,6 +536,7 @@ void InitParameters(void)
 	gParams->disposition = 1;
 	gParams->ignoreSelection = false;
 	gParams->percent = 50;
+	gParams->seed = (int32)time(NULL);
 }
 
 void CreateDataHandle(void)
@@ -396,49 +563,42 @@ void InitData(void)
 	gData->proxyRect.bottom = 0;
 	gData->scaleFactor = 1.0;
 	gData->queryForParameters = true;
-	gData->invertBufferID = NULL;
-	gData->invertBuffer = NULL;
 	gData->proxyBufferID = NULL;
 	gData->proxyBuffer = NULL;
+	gData->proxyBufferCapacity = 0;
 	gData->proxyWidth = 0;
 	gData->proxyHeight = 0;
 	gData->proxyPlaneSize = 0;
-}
-
-void CreateInvertBuffer(const int32 width, const int32 height)
-{
-	BufferProcs* bufferProcs = gFilterRecord->bufferProcs;
-
-	bufferProcs->allocateProc(width * height, &gData->invertBufferID);
-	gData->invertBuffer = bufferProcs->lockProc(gData->invertBufferID, true);
-}
-
-
-void UpdateInvertBuffer(const int32 width, const int32 height)
-{
-	if (gData->invertBuffer != NULL)
-	{
-		Ptr invert = gData->invertBuffer;
-		for (int32 x = 0; x < width; x++)
-		{
-			for (int32 y = 0; y < height; y++)
-			{
-				*invert = ((unsigned16)rand()) % 100 < gParams->percent;
-				invert++;
-			}
-		}
-	}
-}
-
-void DeleteInvertBuffer(void)
-{
-	if (gData->invertBufferID != NULL)
-	{
-		gFilterRecord->bufferProcs->unlockProc(gData->invertBufferID);
-		gFilterRecord->bufferProcs->freeProc(gData->invertBufferID);
-		gData->invertBufferID = NULL;
-		gData->invertBuffer = NULL;
-	}
+	gData->proxyGeneration = 0;
+	memset(&gData->proxyParams, 0, sizeof(gData->proxyParams));
+	gData->proxyParamsSource = 0;
+	gData->proxyDisplayID = NULL;
+	gData->proxyDisplay = NULL;
+	gData->proxyDisplayCapacity = 0;
+	gData->proxyDisplayGeneration = 0;
+	gData->proxyDisplayWidth = 0;
+	gData->proxyDisplayHeight = 0;
+	gData->proxyDisplayMode = 0;
+	gData->proxyDisplayProfile = 0;
+	gData->proxyDisplayMonitor = false;
+	gData->proxySourceID = NULL;
+	gData->proxySource = NULL;
+	gData->proxySourceCapacity = 0;
+	gData->proxySourceRect = gData->proxyRect;
+	gData->proxySourceRate = 0;
+	gData->proxySourceWidth = 0;
+	gData->proxySourceHeight = 0;
+	gData->proxySourceMasked = false;
+	gData->proxySourceDithered = false;
+	gData->proxySourceComplete = false;
+	gData->proxySourceVersion = 1;
+	gData->proxySourceProfile = 0;
+	gData->proxyDither = true;
+	gData->proxyZoom = 0;
+	gData->proxyCenter.h = 0;
+	gData->proxyCenter.v = 0;
+	gData->spaceBudget = 0;
+	gData->arenaBudget = 0;
 }
 
 void SetupFilterRecordForProxy(void)
@@ -448,7 +608,7 @@ void SetupFilterRecordForProxy(void)
 	SetInRect(GetFilterRect());
 	VRect tempRect = GetInRect();
 
-	ScaleRect(tempRect, 1, (int16)gData->scaleFactor);
+	ScaleRect(tempRect, 1, (int32)gData->scaleFactor);
 
 	SetInRect(tempRect);
 
@@ -462,9 +622,14 @@ void SetupFilterRecordForProxy(void)
 	gData->proxyWidth = gData->proxyRect.right - gData->proxyRect.left;
 	gData->proxyHeight = gData->proxyRect.bottom - gData->proxyRect.top;
 	gData->proxyPlaneSize = gData->proxyWidth * gData->proxyHeight;
+
+	SetupProxyView();
 }
 
 
+// inputRate carries the proxy rate as 16.16 fixed point
+const float kMaxProxyRate = 32767.0f;
+
 void CalcProxyScaleFactor(void)
 {
 	int32 filterHeight, filterWidth, itemHeight, itemWidth;
@@ -496,8 +661,12 @@ void CalcProxyScaleFactor(void)
 		gData->scaleFactor = ((float)filterHeight + (float)itemHeight) /
 		(float)itemHeight;
 
+	// a 300000 pixel canvas in a tiny proxy would wrap the 16.16 inputRate
+	if (gData->scaleFactor > kMaxProxyRate)
+		gData->scaleFactor = kMaxProxyRate;
+
 	CopyRect(gData->proxyRect, filterRect);
-	ScaleRect(gData->proxyRect, 1, (int16)gData->scaleFactor);
+	ScaleRect(gData->proxyRect, 1, (int32)gData->scaleFactor);
 
 	if (fraction.h > fraction.v)
 		gData->scaleFactor = (float)filterWidth /
@@ -507,6 +676,9 @@ void CalcProxyScaleFactor(void)
 		gData->scaleFactor = (float)filterHeight /
 		(float)(gData->proxyRect.bottom -
 			gData->proxyRect.top);
+
+	if (gData->scaleFactor > kMaxProxyRate)
+		gData->scaleFactor = kMaxProxyRate;
 }
 
 
@@ -560,23 +732,24 @@ void UnlockHandles(void)
 		gFilterRecord->handleProcs->unlockProc(gFilterRecord->parameters);
 }
 
-void ScaleRect(VRect& destination, const int16 num, const int16 den)
+// 32 bit coordinates, big documents run past what 16 bits hold
+void ScaleRect(VRect& destination, const int32 num, const int32 den)
 {
 	if (den != 0)
 	{
-		destination.left = (int16)((destination.left * num) / den);
-		destination.top = (int16)((destination.top * num) / den);
-		destination.right = (int16)((destination.right * num) / den);
-		destination.bottom = (int16)((destination.bottom * num) / den);
+		destination.left = (int32)(((int64)destination.left * num) / den);
+		destination.top = (int32)(((int64)destination.top * num) / den);
+		destination.right = (int32)(((int64)destination.right * num) / den);
+		destination.bottom = (int32)(((int64)destination.bottom * num) / den);
 	}
 }
 
-void ShrinkRect(VRect& destination, const int16 width, const int16 height)
+void ShrinkRect(VRect& destination, const int32 width, const int32 height)
 {
-	destination.left = (int16)(destination.left + width);
-	destination.top = (int16)(destination.top + height);
-	destination.right = (int16)(destination.right - width);
-	destination.bottom = (int16)(destination.bottom - height);
+	destination.left = destination.left + width;
+	destination.top = destination.top + height;
+	destination.right = destination.right - width;
+	destination.bottom = destination.bottom - height;
 }
 
 
@@ -606,96 +779,298 @@ void SetColor(FilterColor& destination,
 	destination[3] = d;
 }
 
+//-------------------------------------------------------------------------------
+//
+// CreateProxyBuffer
+//
+// The buffer the dialog displays. Calling it again, say for a new proxy size
+// or DPI, keeps the buffer it has unless the new proxy doesn't fit, and leaves
+// the source cache alone.
+//
+//-------------------------------------------------------------------------------
 void CreateProxyBuffer(void)
 {
-	int32 proxySize = gData->proxyPlaneSize * gFilterRecord->planes;
-	OSErr e = gFilterRecord->bufferProcs->allocateProc(proxySize, &gData->proxyBufferID);
-	if (!e && gData->proxyBufferID)
-		gData->proxyBuffer = gFilterRecord->bufferProcs->lockProc(gData->proxyBufferID, true);
+	int64 proxySize;
+	if (!BufferBytes(gData->proxyPlaneSize, gFilterRecord->planes, 1, proxySize))
+	{
+		gData->proxyBuffer = NULL;
+		return;
+	}
+	gData->proxyBuffer = ReserveBuffer(gData->proxyBufferID, gData->proxyBufferCapacity, proxySize);
+}
+
+static void DeleteProxySource(void)
+{
+	// the preview renderer reads the source, it has to let go first
+	StopPreviewRenderer();
+
+	ReleaseBuffer(gData->proxySourceID, gData->proxySourceCapacity);
+	gData->proxySource = NULL;
+}
+
+// the cache holds what SetupFilterRecordForProxy asks for now
+static Boolean ProxySourceIsCurrent(void)
+{
+	VRect inRect = GetInRect();
+	return gData->proxySource != NULL &&
+		gData->proxySourceRate == gFilterRecord->inputRate &&
+		gData->proxySourceWidth == gData->proxyWidth &&
+		gData->proxySourceHeight == gData->proxyHeight &&
+		gData->proxySourceDithered == gData->proxyDither &&
+		gData->proxySourceRect.left == inRect.left &&
+		gData->proxySourceRect.top == inRect.top &&
+		gData->proxySourceRect.right == inRect.right &&
+		gData->proxySourceRect.bottom == inRect.bottom;
 }
 
+//-------------------------------------------------------------------------------
+//
+// ReadProxySource
+//
+// Bring the proxy's view of the source down to 8 bits and keep it, with the
+// mask after the planes, for the rest of the dialog. The view comes out of
+// the pyramid, which only goes to the host for tiles it hasn't seen. A
+// progressive read only fills in a coarse version and leaves the rest to
+// RefineProxyBuffer.
+//
+//-------------------------------------------------------------------------------
+static void ReadProxySource(Boolean progressive)
+{
+	// the preview renderer reads the source, it has to let go first
+	StopPreviewRenderer();
+	gData->proxySource = NULL;
+
+	int64 sourceSize;
+	if (!BufferBytes(gData->proxyPlaneSize, gFilterRecord->planes + 1, 1, sourceSize))
+		return;
+
+	// kept only once the read has filled it
+	AutoBuffer source(gData->proxySourceID, gData->proxySourceCapacity);
+	uint8* proxyPixel = (uint8*)source.Reserve(sourceSize);
+	if (proxyPixel == NULL)
+		return;
+
+	Boolean masked = false;
+	if (progressive)
+		*gResult = ReadCoarseProxyView(proxyPixel, masked);
+	else
+		*gResult = ReadProxyView(proxyPixel, masked);
+	if (*gResult != noErr)
+		return;
+
+	source.Keep();
+	gData->proxySource = (Ptr)proxyPixel;
+	gData->proxySourceMasked = masked;
+	gData->proxySourceRect = GetInRect();
+	gData->proxySourceRate = gFilterRecord->inputRate;
+	gData->proxySourceWidth = gData->proxyWidth;
+	gData->proxySourceHeight = gData->proxyHeight;
+	gData->proxySourceDithered = gData->proxyDither;
+	gData->proxySourceComplete = !progressive;
+	gData->proxySourceVersion++;
+	gData->proxySourceProfile = ProxyProfileHash();
+}
+
+//-------------------------------------------------------------------------------
+//
+// ResetProxyBuffer
+//
+// Put the untouched source back in the display buffer. Only the first call
+// for a proxy size goes to the host, parameter edits after that copy from the
+// cache.
+//
+//-------------------------------------------------------------------------------
 extern "C" void ResetProxyBuffer(void)
 {
-	uint8* proxyPixel = (uint8*)gData->proxyBuffer;
+	if (gData->proxyBuffer == NULL)
+		return;
+
+	if (!ProxySourceIsCurrent())
+		ReadProxySource(false);
 
-	if (proxyPixel != NULL)
+	if (gData->proxySource != NULL)
+		memcpy(gData->proxyBuffer, gData->proxySource, (size_t)gData->proxyPlaneSize * gFilterRecord->planes);
+}
+
+//-------------------------------------------------------------------------------
+//
+// StartProgressiveProxy
+//
+// Called before ResetProxyBuffer. When the view isn't cached and is big
+// enough that reading it would hold up the dialog, the source is filled from
+// a coarser level now and the dialog calls RefineProxyBuffer from its idle
+// time until it returns false. Returns true while there is refining to do.
+//
+//-------------------------------------------------------------------------------
+extern "C" Boolean StartProgressiveProxy(void)
+{
+	if (gData->proxyBuffer == NULL)
+		return false;
+
+	if (!ProxySourceIsCurrent() && ProgressiveProxyView())
+		ReadProxySource(true);
+
+	return gData->proxySource != NULL && !gData->proxySourceComplete;
+}
+
+//-------------------------------------------------------------------------------
+//
+// RefineProxyBuffer
+//
+// Read one more row of tiles into a coarse source. The display buffer is left
+// alone, the dialog redraws from the source once this returns. Returns true
+// while more rows remain.
+//
+//-------------------------------------------------------------------------------
+extern "C" Boolean RefineProxyBuffer(void)
+{
+	if (gData->proxyBuffer == NULL || gData->proxySourceComplete || !ProxySourceIsCurrent())
+		return false;
+
+	// a frame being drawn from the source mustn't see it change under it
+	StopPreviewRenderer();
+
+	Boolean more = false;
+	*gResult = RefineProxyView((uint8*)gData->proxySource, more);
+	if (*gResult != noErr)
 	{
-		for (int16 plane = 0; plane < gFilterRecord->planes; plane++)
-		{
-			gFilterRecord->inLoPlane = plane;
-			gFilterRecord->inHiPlane = plane;
+		// what is there stays on screen, the full read happens on the next reset
+		DeleteProxySource();
+		return false;
+	}
 
-			*gResult = gFilterRecord->advanceState();
-			if (*gResult != noErr) return;
+	gData->proxySourceComplete = !more;
+	gData->proxySourceVersion++;
+	return more;
+}
 
-			uint8* inPixel = (uint8*)gFilterRecord->inData;
+// rows are refined for at most this long before the dialog gets to draw them
+const double kRefineSliceMilliseconds = 50.0;
 
-			for (int32 y = 0; y < gData->proxyHeight; y++)
-			{
-				uint8* start = inPixel;
-
-				for (int32 x = 0; x < gData->proxyWidth; x++)
-				{
-					if (gFilterRecord->depth == 32)
-					{
-						float* reallyBigPixel = (float*)inPixel;
-						if (*reallyBigPixel > 1.0)
-							*reallyBigPixel = 1.0;
-						if (*reallyBigPixel < 0.0)
-							*reallyBigPixel = 0.0;
-						*proxyPixel = (uint8)(*reallyBigPixel * 255);
-						inPixel += 4;
-					}
-					else 	if (gFilterRecord->depth == 16)
-					{
-						uint16* bigPixel = (uint16*)inPixel;
-						*proxyPixel = (uint8)(*bigPixel * 10 / 1285);
-						inPixel += 2;
-					}
-					else
-					{
-						*proxyPixel = *inPixel;
-						inPixel++;
-					}
-					proxyPixel++;
-				}
-				inPixel = start + gFilterRecord->inRowBytes;
-			}
-		}
+typedef struct RefineTaskData
+{
+	PSProgressSuite2* progress;
+	Boolean more;
+} RefineTaskData;
+
+// DoPreviewTask makes TestAbort answer true as soon as the user does anything
+static SPErr RefineTask(void* refCon)
+{
+	RefineTaskData* task = (RefineTaskData*)refCon;
+	PipelineClock::time_point started = PipelineClock::now();
+	do
+	{
+		task->more = RefineProxyBuffer();
 	}
+	while (task->more &&
+		   !(task->progress->TestAbort)() &&	// not the PIUtilities macro
+		   MillisecondsSince(started) < kRefineSliceMilliseconds);
+	return noErr;
+}
+
+//-------------------------------------------------------------------------------
+//
+// RefineProxyInPreviewTask
+//
+// RefineProxyBuffer a row at a time leaves the host idle between timer ticks.
+// Inside the progress suite's preview task it keeps reading rows of tiles for
+// a slice of time, giving up the moment a key or mouse button is pressed, so
+// a zoomed in view at screen resolution fills as fast as the host allows and
+// an edit never waits on it. The tiles stay in the pyramid, so parameter
+// edits after that redraw from memory. Hosts without the suite refine a row
+// per call as before. Returns true while more rows remain.
+//
+//-------------------------------------------------------------------------------
+extern "C" Boolean RefineProxyInPreviewTask(void)
+{
+	PSProgressSuite2* progress = NULL;
+	if (sSPBasic == NULL ||
+		sSPBasic->AcquireSuite(kPSProgressSuite,
+							   kPSProgressSuiteVersion2,
+							   (const void**)&progress) != noErr ||
+		progress == NULL)
+		return RefineProxyBuffer();
+
+	RefineTaskData task;
+	task.progress = progress;
+	task.more = false;
+	if (progress->DoPreviewTask == NULL || progress->TestAbort == NULL ||
+		progress->DoPreviewTask("up", RefineTask, &task) != noErr)
+		task.more = RefineProxyBuffer();
+
+	sSPBasic->ReleaseSuite(kPSProgressSuite, kPSProgressSuiteVersion2);
+	return task.more;
+}
+
+// field by field, the struct has padding
+static Boolean SameParameters(const Parameters& a, const Parameters& b)
+{
+	return a.percent == b.percent &&
+		a.disposition == b.disposition &&
+		a.ignoreSelection == b.ignoreSelection &&
+		a.seed == b.seed;
 }
 
 extern "C" void UpdateProxyBuffer(void)
 {
 	Ptr localData = gData->proxyBuffer;
 
-	if (localData != NULL)
+	if (localData != NULL && gData->proxySource != NULL)
 	{
-		UpdateInvertBuffer(gData->proxyWidth, gData->proxyHeight);
+		// the renderer's frames are timed on the same clock
+		PipelineClock::time_point start = PipelineClock::now();
+
+		// proxy pixels are document pixels sampled every step from inRect,
+		// give InvertRectangle that origin so it picks what the filter will
+		int32 step = gData->proxySourceRate >> 16;
+		if (step < 1)
+			step = 1;
+
+		VRect sampleRect = gData->proxySourceRect;
+		sampleRect.right = sampleRect.left + gData->proxyWidth;
+		sampleRect.bottom = sampleRect.top + gData->proxyHeight;
+
+		Ptr maskData = NULL;
+		if (gData->proxySourceMasked)
+			maskData = gData->proxySource + (size_t)gData->proxyPlaneSize * gFilterRecord->planes;
+
 		for (int16 plane = 0; plane < gFilterRecord->planes; plane++)
 		{
-			uint8 color = 255;
-			uint16 expectedPlanes = CSPlanesFromMode(gFilterRecord->imageMode, 0);
-			if (plane < expectedPlanes)
-				color = gData->color[plane];
 			InvertRectangle(localData,
 				gData->proxyWidth,
-				gFilterRecord->maskData,
-				gFilterRecord->maskRowBytes,
-				gData->proxyRect,
-				color,
-				8);
+				maskData,
+				gData->proxyWidth,
+				sampleRect,
+				8,
+				1,
+				step);
 			localData += (gData->proxyPlaneSize);
 		}
+
+		// a DPI change or expose that redraws the same thing keeps the
+		// generation, and with it the converted display cache
+		if (gData->proxyParamsSource != gData->proxySourceVersion ||
+			!SameParameters(gData->proxyParams, *gParams))
+		{
+			gData->proxyParams = *gParams;
+			gData->proxyParamsSource = gData->proxySourceVersion;
+			gData->proxyGeneration++;
+		}
+
+		RecordPreviewFrame(MillisecondsSince(start), gData->proxyWidth, gData->proxyHeight);
 	}
 }
 
 void DeleteProxyBuffer(void)
 {
-	gFilterRecord->bufferProcs->unlockProc(gData->proxyBufferID);
-	gFilterRecord->bufferProcs->freeProc(gData->proxyBufferID);
-	gData->proxyBufferID = NULL;
+	ReleaseBuffer(gData->proxyBufferID, gData->proxyBufferCapacity);
 	gData->proxyBuffer = NULL;
+
+	DeleteProxyDisplay();
+	DeleteProxySource();
+	DeletePyramid();
+	LogBufferCounters();
+	LogPreviewTiming();
 }
 
 
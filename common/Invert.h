@@ -22,6 +22,7 @@ typedef struct Parameters
 	int16 percent;
 	int16 disposition;
 	Boolean ignoreSelection;
+	int32 seed;
 } Parameters, *ParametersPtr;
 
 typedef struct Data
@@ -29,15 +30,43 @@ typedef struct Data
 	FilterColor color;
 	FilterColor colorArray[4];
 	Boolean queryForParameters;
-	BufferID invertBufferID;
-	Ptr invertBuffer;
 	VRect proxyRect;
 	float scaleFactor;
 	BufferID proxyBufferID;
 	Ptr proxyBuffer;
+	int64 proxyBufferCapacity;	// bytes proxyBufferID holds, kept across resizes
 	int32 proxyWidth;
 	int32 proxyHeight;
 	int32 proxyPlaneSize;
+	uint32 proxyGeneration;		// bumped whenever what proxyBuffer shows changes
+	Parameters proxyParams;		// what UpdateProxyBuffer last inverted with
+	uint32 proxyParamsSource;	// and the proxySourceVersion, 0 after a renderer frame
+	BufferID proxyDisplayID;	// proxyBuffer ready for the screen, see InvertDisplay
+	Ptr proxyDisplay;
+	int64 proxyDisplayCapacity;
+	uint32 proxyDisplayGeneration;	// the proxyGeneration proxyDisplay shows
+	int32 proxyDisplayWidth;
+	int32 proxyDisplayHeight;
+	int32 proxyDisplayMode;		// image mode and ICC profile hash it was converted for
+	uint32 proxyDisplayProfile;
+	Boolean proxyDisplayMonitor;	// monitor RGB as BGRX to blit, else RGBA for displayPixels
+	BufferID proxySourceID;		// 8 bit copy of the proxy source, planes then mask
+	Ptr proxySource;
+	int64 proxySourceCapacity;
+	VRect proxySourceRect;		// what proxySource was read from
+	int32 proxySourceRate;
+	int32 proxySourceWidth;
+	int32 proxySourceHeight;
+	Boolean proxySourceMasked;
+	Boolean proxySourceDithered;
+	Boolean proxySourceComplete;	// false while a coarse read waits for RefineProxyBuffer
+	uint32 proxySourceVersion;	// bumped whenever proxySource changes
+	uint32 proxySourceProfile;	// ICC profile hash of the document proxySource came from
+	Boolean proxyDither;		// ordered dither high bit depth sources down to 8 bits
+	int32 proxyZoom;			// levels in from the whole filter rect, each halves the rate
+	VPoint proxyCenter;			// document point in the middle of a zoomed view
+	int64 spaceBudget;
+	int64 arenaBudget;			// plug-in buffer bytes DoPrepare announced, see InvertArena
 } Data;
 
 extern FilterRecord* gFilterRecord;
@@ -53,14 +82,31 @@ void SetColor(FilterColor& destination,
 			  const uint8 b, 
 			  const uint8 c, 
 			  const uint8 d);
-void CreateInvertBuffer(const int32 width, const int32 height);
-void UpdateInvertBuffer(const int32 width, const int32 height);
-void DeleteInvertBuffer(void);
 void CreateProxyBuffer(void);
 extern "C" void ResetProxyBuffer(void);
 extern "C" void UpdateProxyBuffer(void);
+extern "C" Boolean StartProgressiveProxy(void);
+extern "C" Boolean RefineProxyBuffer(void);
+extern "C" Boolean RefineProxyInPreviewTask(void);
 void DeleteProxyBuffer(void);
 int32 DisplayPixelsMode(int16 mode);
+void InvertRectangle(const Parameters& params,
+					 void* data,
+					 int32 dataRowBytes,
+					 void* mask,
+					 int32 maskRowBytes,
+					 VRect tileRect,
+					 int32 depth,
+					 int32 planes,
+					 int32 step);
+void InvertRectangle(void* data,
+					 int32 dataRowBytes,
+					 void* mask,
+					 int32 maskRowBytes,
+					 VRect tileRect,
+					 int32 depth,
+					 int32 planes,
+					 int32 step);
 
 
 #endif
\ No newline at end of file
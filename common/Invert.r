@@ -156,6 +156,12 @@ resource 'aete' (16000, "Invert dictionary", purgeable)
 				keyIgnoreSelection,							/* key ID */
 				typeBoolean,								/* type */
 				"filter entire image",						/* optional desc */
+				flagsSingleParameter,						/* parameter flags */
+
+				"seed",										/* optional parameter */
+				keyRandomSeed,								/* key ID */
+				typeInteger,								/* type */
+				"random seed for partial inversion",		/* optional desc */
 				flagsSingleParameter						/* parameter flags */
 
 			}
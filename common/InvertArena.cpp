@@ -0,0 +1,123 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertArena.h"
+#include "InvertBuffers.h"
+#include "Logger.h"
+#include <string.h>
+
+//-------------------------------------------------------------------------------
+//
+// Session arena
+//
+// DoPrepare tells the host how much buffer memory the filter run will use.
+// DoStart takes exactly that as one buffer, and the tile slots of the
+// pipeline and the channel port engine are cut from it instead of each being
+// a host allocation with its own lock. Pieces are only ever given back in
+// the reverse order they were taken, by rewinding to a mark, and DoFinish
+// frees the lot. A request that doesn't fit gets NULL and the caller goes to
+// the host as before.
+//
+// Only the thread that talks to the host allocates, no lock.
+//
+//-------------------------------------------------------------------------------
+typedef struct Arena
+{
+	BufferID bufferID;
+	uint8* base;			// aligned start of the usable bytes
+	int64 size;
+	ArenaUsage usage;
+} Arena;
+
+static Arena gArena;
+
+Boolean OpenArena(int64 size)
+{
+	CloseArena();
+	memset(&gArena.usage, 0, sizeof(gArena.usage));
+	if (size <= 0)
+		return false;
+
+	// room to move the start onto the alignment
+	int64 reserved = size + kArenaAlignment - 1;
+	BufferID bufferID = NULL;
+	if (AllocateHostBuffer(reserved, &bufferID) != noErr || bufferID == NULL)
+		return false;
+
+	Ptr pointer = gFilterRecord->bufferProcs->lockProc(bufferID, true);
+	if (pointer == NULL)
+	{
+		FreeHostBuffer(bufferID, reserved);
+		return false;
+	}
+
+	uintptr_t start = ((uintptr_t)pointer + kArenaAlignment - 1) & ~(uintptr_t)(kArenaAlignment - 1);
+	gArena.bufferID = bufferID;
+	gArena.base = (uint8*)start;
+	gArena.size = size;
+	gArena.usage.reserved = reserved;
+	return true;
+}
+
+void* ArenaAllocate(int64 size)
+{
+	int64 start = (gArena.usage.used + kArenaAlignment - 1) & ~(int64)(kArenaAlignment - 1);
+	if (gArena.base == NULL || size < 0 || size > gArena.size - start)
+	{
+		gArena.usage.misses++;
+		return NULL;
+	}
+
+	gArena.usage.used = start + size;
+	gArena.usage.allocations++;
+	if (gArena.usage.used > gArena.usage.highWater)
+		gArena.usage.highWater = gArena.usage.used;
+	return gArena.base + start;
+}
+
+int64 ArenaMark(void)
+{
+	return gArena.usage.used;
+}
+
+void ArenaRewind(int64 mark)
+{
+	if (mark >= 0 && mark < gArena.usage.used)
+		gArena.usage.used = mark;
+}
+
+void CloseArena(void)
+{
+	FreeHostBuffer(gArena.bufferID, gArena.usage.reserved);
+	gArena.base = NULL;
+	gArena.size = 0;
+	gArena.usage.used = 0;
+}
+
+void GetArenaUsage(ArenaUsage& usage)
+{
+	usage = gArena.usage;
+}
+
+void LogArenaUsage(void)
+{
+	Logger logIt("Invert");
+	logIt.Write("Arena reserved ", false);
+	logIt.Write((double)gArena.usage.reserved, false);
+	logIt.Write(" high water ", false);
+	logIt.Write((double)gArena.usage.highWater, false);
+	logIt.Write(" allocations ", false);
+	logIt.Write(gArena.usage.allocations, false);
+	logIt.Write(" misses ", false);
+	logIt.Write(gArena.usage.misses, true);
+}
+
+// end InvertArena.cpp
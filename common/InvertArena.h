@@ -0,0 +1,70 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+#ifndef _INVERTARENA_H
+#define _INVERTARENA_H
+
+#include "Invert.h"
+
+// every piece handed out starts on a cache line, wide enough for any kernel
+const int32 kArenaAlignment = 64;
+
+// what the session arena has been asked for since it was opened
+typedef struct ArenaUsage
+{
+	int64 reserved;			// bytes taken from the host in one buffer
+	int64 used;				// handed out right now
+	int64 highWater;		// most ever handed out at once
+	int32 allocations;
+	int32 misses;			// requests that didn't fit and went to the host
+} ArenaUsage;
+
+// Take size bytes from the host as one locked buffer for the rest of the
+// filter run. Returns false, leaving no arena, when size is 0 or the host
+// can't give it.
+Boolean OpenArena(int64 size);
+
+// A kArenaAlignment aligned piece of the arena, NULL when there is no arena
+// or not enough of it left.
+void* ArenaAllocate(int64 size);
+
+// Everything handed out after mark, which ArenaMark returned, goes back.
+int64 ArenaMark(void);
+void ArenaRewind(int64 mark);
+
+// Give the whole arena back to the host with a single free.
+void CloseArena(void);
+
+void GetArenaUsage(ArenaUsage& usage);
+void LogArenaUsage(void);
+
+// Closes the arena when it goes out of scope unless Keep was called, so a
+// filter run that fails, or throws, gives it back before the host skips
+// DoFinish.
+class AutoArena
+{
+public:
+	AutoArena() : kept(false) { }
+	~AutoArena()
+	{
+		if (!kept)
+			CloseArena();
+	}
+	void Keep(void) { kept = true; }
+
+private:
+	bool kept;
+
+	AutoArena(const AutoArena&);
+	AutoArena& operator=(const AutoArena&);
+};
+
+#endif
+// end InvertArena.h
@@ -0,0 +1,203 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertBuffers.h"
+#include "Logger.h"
+#include <string.h>
+#include <stdint.h>
+
+//-------------------------------------------------------------------------------
+//
+// Buffer manager
+//
+// The dialog rebuilds its proxy on every resize and DPI change, usually at a
+// size it has had before. The proxy, the arena and the pyramid tiles go
+// through ReserveBuffer, which keeps the buffer it has when it is big enough,
+// so dragging the dialog between monitors costs no allocations once each
+// size has been seen. A buffer only ever grows, and everything is given back
+// by ReleaseBuffer when the dialog or the filter run is done with it.
+//
+// The preview renderer's back and front frames are not host buffers. They
+// are filled on the renderer's own thread, which may not call bufferProcs,
+// so they are plain heap memory owned by the renderer and freed with it.
+//
+// Every buffer from the host is counted here, so a debug build can tell at
+// DoFinish whether a run left any behind. Long action runs that leak one
+// buffer per run end up with the host swapping its tiles out.
+//
+// Only the thread that talks to the host allocates, the counters need no lock.
+//
+//-------------------------------------------------------------------------------
+static BufferCounters gBufferCounters;
+
+// the most a buffer can hold, half the address space leaves room for the rest
+const int64 kMaxBufferBytes = (int64)(PTRDIFF_MAX / 2);
+
+OSErr AllocateHostBuffer(int64 size, BufferID* id)
+{
+	*id = NULL;
+
+	OSErr e = memFullErr;
+	if (size >= 0 && size <= kMaxBufferBytes)
+		e = HostAllocateBuffer64(gFilterRecord->bufferProcs, size, id);
+
+	if (e || *id == NULL)
+	{
+		*id = NULL;
+		gBufferCounters.failures++;
+		return e ? e : memFullErr;
+	}
+
+	gBufferCounters.allocations++;
+	gBufferCounters.live++;
+	gBufferCounters.liveBytes += size;
+	if (gBufferCounters.liveBytes > gBufferCounters.peakBytes)
+		gBufferCounters.peakBytes = gBufferCounters.liveBytes;
+	return noErr;
+}
+
+void FreeHostBuffer(BufferID& id, int64 size)
+{
+	if (id != NULL)
+	{
+		gFilterRecord->bufferProcs->unlockProc(id);
+		gFilterRecord->bufferProcs->freeProc(id);
+		gBufferCounters.frees++;
+		gBufferCounters.live--;
+		gBufferCounters.liveBytes -= size;
+	}
+	id = NULL;
+}
+
+Boolean BufferBytes(int64 width, int64 height, int64 pixelBytes, int64& bytes)
+{
+	return BufferBytes(width, height, pixelBytes, 1, bytes);
+}
+
+Boolean BufferBytes(int64 width, int64 height, int64 pixelBytes, int64 count, int64& bytes)
+{
+	bytes = 0;
+	if (width < 0 || height < 0 || pixelBytes < 0 || count < 0)
+		return false;
+
+	// each step is checked against what is left before it multiplies
+	int64 total = 1;
+	int64 factors[4] = { width, height, pixelBytes, count };
+	for (int32 f = 0; f < 4; f++)
+	{
+		if (factors[f] == 0)
+			return true;
+		if (total > kMaxBufferBytes / factors[f])
+			return false;
+		total *= factors[f];
+	}
+	bytes = total;
+	return true;
+}
+
+Ptr ReserveBuffer(BufferID& id, int64& capacity, int64 size)
+{
+	if (id != NULL && capacity >= size)
+	{
+		// relocking keeps the lock count at one
+		gBufferCounters.reuses++;
+		gFilterRecord->bufferProcs->unlockProc(id);
+		return gFilterRecord->bufferProcs->lockProc(id, true);
+	}
+
+	ReleaseBuffer(id, capacity);
+
+	if (AllocateHostBuffer(size, &id) != noErr)
+		return NULL;
+
+	capacity = size;
+	return gFilterRecord->bufferProcs->lockProc(id, true);
+}
+
+void ReleaseBuffer(BufferID& id, int64& capacity)
+{
+	FreeHostBuffer(id, capacity);
+	capacity = 0;
+}
+
+AutoHandleLock::AutoHandleLock(Handle handle, Boolean moveHigh)
+	: locked(NULL), pointer(NULL)
+{
+	if (handle == NULL)
+		return;
+
+	pointer = gFilterRecord->handleProcs->lockProc(handle, moveHigh);
+	if (pointer == NULL)
+		return;
+
+	locked = handle;
+	gBufferCounters.handleLocks++;
+}
+
+AutoHandleLock::~AutoHandleLock()
+{
+	if (locked == NULL)
+		return;
+
+	gFilterRecord->handleProcs->unlockProc(locked);
+	gBufferCounters.handleLocks--;
+}
+
+void GetBufferCounters(BufferCounters& counters)
+{
+	counters = gBufferCounters;
+}
+
+void ResetBufferCounters(void)
+{
+	int32 live = gBufferCounters.live;
+	int64 liveBytes = gBufferCounters.liveBytes;
+	int32 handleLocks = gBufferCounters.handleLocks;
+	memset(&gBufferCounters, 0, sizeof(gBufferCounters));
+	gBufferCounters.live = live;
+	gBufferCounters.liveBytes = liveBytes;
+	gBufferCounters.peakBytes = liveBytes;
+	gBufferCounters.handleLocks = handleLocks;
+}
+
+void LogBufferCounters(void)
+{
+	Logger logIt("Invert");
+	logIt.Write("Buffers allocated ", false);
+	logIt.Write(gBufferCounters.allocations, false);
+	logIt.Write(" reused ", false);
+	logIt.Write(gBufferCounters.reuses, false);
+	logIt.Write(" freed ", false);
+	logIt.Write(gBufferCounters.frees, false);
+	logIt.Write(" failed ", false);
+	logIt.Write(gBufferCounters.failures, false);
+	logIt.Write(" live ", false);
+	logIt.Write(gBufferCounters.live, false);
+	logIt.Write(" peak bytes ", false);
+	logIt.Write((double)gBufferCounters.peakBytes, true);
+}
+
+Boolean CheckBufferBalance(void)
+{
+	if (gBufferCounters.live == 0 && gBufferCounters.handleLocks == 0)
+		return true;
+
+	Logger logIt("Invert");
+	logIt.Write("Buffers leaked ", false);
+	logIt.Write(gBufferCounters.live, false);
+	logIt.Write(" bytes ", false);
+	logIt.Write((double)gBufferCounters.liveBytes, false);
+	logIt.Write(" handle locks ", false);
+	logIt.Write(gBufferCounters.handleLocks, true);
+	return false;
+}
+
+// end InvertBuffers.cpp
@@ -0,0 +1,107 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+#ifndef _INVERTBUFFERS_H
+#define _INVERTBUFFERS_H
+
+#include "Invert.h"
+
+// what the host's bufferProcs have been asked for since the last reset
+typedef struct BufferCounters
+{
+	int32 allocations;
+	int32 reuses;
+	int32 frees;
+	int32 failures;
+	int32 live;				// buffers held right now
+	int64 liveBytes;
+	int64 peakBytes;
+	int32 handleLocks;		// AutoHandleLocks in scope right now
+} BufferCounters;
+
+// Return a locked buffer of at least size bytes in id. One that is already
+// big enough is handed back as it is, a smaller one is freed and replaced.
+// Returns NULL, with id and capacity cleared, when the host is out of memory.
+Ptr ReserveBuffer(BufferID& id, int64& capacity, int64 size);
+
+// Unlock and free id if there is one, clearing id and capacity.
+void ReleaseBuffer(BufferID& id, int64& capacity);
+
+// allocateProc64 where the host has it, allocateProc up to 2 GB otherwise
+OSErr AllocateHostBuffer(int64 size, BufferID* id);
+
+// Unlock and free a buffer of size bytes from AllocateHostBuffer, clearing id.
+void FreeHostBuffer(BufferID& id, int64 size);
+
+// Bytes in a width by height block of pixelBytes pixels, or in count such
+// blocks. False, with bytes 0, for a negative size or one that doesn't fit
+// the address space.
+Boolean BufferBytes(int64 width, int64 height, int64 pixelBytes, int64& bytes);
+Boolean BufferBytes(int64 width, int64 height, int64 pixelBytes, int64 count, int64& bytes);
+
+void GetBufferCounters(BufferCounters& counters);
+void ResetBufferCounters(void);
+
+// Write the counters to the log, after the dialog has freed its buffers.
+void LogBufferCounters(void);
+
+// True when every buffer and AutoHandleLock taken since the plug-in loaded
+// has been given back, otherwise the leak goes to the log.
+Boolean CheckBufferBalance(void);
+
+// Holds the buffer in id and capacity, which may be Data's, while it is in
+// scope. Leaving the scope, by an early return or an exception on its way to
+// PluginMain, releases the buffer unless Keep has handed it on.
+class AutoBuffer
+{
+public:
+	AutoBuffer(BufferID& bufferID, int64& bufferCapacity)
+		: id(bufferID), capacity(bufferCapacity), kept(false)
+	{ }
+
+	~AutoBuffer()
+	{
+		if (!kept)
+			ReleaseBuffer(id, capacity);
+	}
+
+	Ptr Reserve(int64 size) { return ReserveBuffer(id, capacity, size); }
+	void Keep(void) { kept = true; }
+
+private:
+	BufferID& id;
+	int64& capacity;
+	bool kept;
+
+	// make sure the compiler doesn't create these
+	AutoBuffer(const AutoBuffer&);
+	AutoBuffer& operator=(const AutoBuffer&);
+};
+
+// A handle locked for as long as the guard is in scope, Get is NULL when
+// there is no handle or the host can't lock it.
+class AutoHandleLock
+{
+public:
+	AutoHandleLock(Handle handle, Boolean moveHigh);
+	~AutoHandleLock();
+
+	Ptr Get(void) const { return pointer; }
+
+private:
+	Handle locked;
+	Ptr pointer;
+
+	AutoHandleLock(const AutoHandleLock&);
+	AutoHandleLock& operator=(const AutoHandleLock&);
+};
+
+#endif
+// end InvertBuffers.h
@@ -0,0 +1,311 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertDisplay.h"
+#include "InvertBuffers.h"
+#include "PIUtilities.h"
+#include "FilterBigDocument.h"
+#include "PIColorSpaceSuite.h"
+
+//-------------------------------------------------------------------------------
+//
+// Proxy display cache
+//
+// displayPixels gathers a planar map into the screen's layout and colour
+// manages it on every call, and most paints are exposes with nothing new to
+// show. The proxy is instead converted once per proxyGeneration. Where the
+// host has the colour space suite it goes through ConvertForDisplay to
+// monitor RGB, which the dialog blits as it is, otherwise gray and RGB are
+// interleaved to RGBA for displayPixels. Either way the layer's transparency
+// is blended over the checkerboard here, and a paint only hands over the
+// rows that were invalidated.
+//
+// CMYK, Lab and Duotone conversions depend on the document's profile as well
+// as the pixels, so the cache is also keyed by image mode and a hash of
+// iCCprofileData. Repaints and DPI changes that redraw the same proxy reuse
+// it.
+//
+//-------------------------------------------------------------------------------
+const int32 kDisplayBytes = 4;
+const int32 kCheckerSize = 8;
+const uint8 kCheckerLight = 0xFF;
+const uint8 kCheckerDark = 0xCC;
+
+// colour planes the RGBA path can show, 0 for the modes it leaves to the host
+static int32 DisplayColors(void)
+{
+	switch (DisplayPixelsMode(gFilterRecord->imageMode))
+	{
+	case plugInModeGrayScale:
+		return 1;
+	case plugInModeRGBColor:
+		return 3;
+	}
+	return 0;
+}
+
+// c over the checkerboard square at x, y with opacity alpha
+static inline uint8 OverChecker(uint8 c, uint8 alpha, int32 x, int32 y)
+{
+	uint8 checker = ((x / kCheckerSize) ^ (y / kCheckerSize)) & 1 ? kCheckerDark : kCheckerLight;
+	return (uint8)((c * alpha + checker * (255 - alpha) + 127) / 255);
+}
+
+// the layer's transparency plane, after its colour planes, NULL without one
+static const uint8* TransparencyPlane(void)
+{
+	if (gFilterRecord->inLayerPlanes == 0 || gFilterRecord->inTransparencyMask == 0)
+		return NULL;
+
+	int32 alphaPlane = CSPlanesFromMode(gFilterRecord->imageMode, 0);
+	if (alphaPlane >= gFilterRecord->planes)
+		return NULL;
+	return (const uint8*)gData->proxyBuffer + gData->proxyPlaneSize * alphaPlane;
+}
+
+//-------------------------------------------------------------------------------
+//
+// ProxyProfileHash
+//
+// FNV-1a of the document's ICC profile, 0 when there isn't one. Hashing means
+// locking the profile and reading all of it, so it is done once per source
+// read and UpdateProxyDisplay compares what was stored then.
+//
+//-------------------------------------------------------------------------------
+uint32 ProxyProfileHash(void)
+{
+	Handle profile = gFilterRecord->iCCprofileData;
+	int32 size = gFilterRecord->iCCprofileSize;
+	if (!gFilterRecord->canUseICCProfiles || profile == NULL || size <= 0)
+		return 0;
+
+	AutoHandleLock locked(profile, false);
+	const uint8* bytes = (const uint8*)locked.Get();
+	if (bytes == NULL)
+		return 0;
+
+	uint32 hash = 2166136261u;
+	for (int32 b = 0; b < size; b++)
+		hash = (hash ^ bytes[b]) * 16777619u;
+	return hash;
+}
+
+//-------------------------------------------------------------------------------
+//
+// ConvertToMonitor
+//
+// The host's conversion of the planar proxy to monitor RGB for the screen
+// under displayArea, turned from the suite's 0RGB to BGRX in place. BGRX is
+// what both a Windows DIB and a little endian CGImage take without copying.
+//
+//-------------------------------------------------------------------------------
+static Boolean ConvertToMonitor(const VRect& displayArea)
+{
+	PSColorSpaceSuite2* colorSpace = NULL;
+	if (sSPBasic == NULL ||
+		sSPBasic->AcquireSuite(kPSColorSpaceSuite,
+							   kPSColorSpaceSuiteVersion2,
+							   (const void**)&colorSpace) != noErr ||
+		colorSpace == NULL)
+		return false;
+
+	VRect inRect = GetInRect();
+	PSPixelMap source;
+	source.version = 1;
+	source.bounds.top = inRect.top;
+	source.bounds.left = inRect.left;
+	source.bounds.bottom = inRect.bottom;
+	source.bounds.right = inRect.right;
+	source.imageMode = DisplayPixelsMode(gFilterRecord->imageMode);
+	source.rowBytes = gData->proxyWidth;
+	source.colBytes = 1;
+	source.planeBytes = gData->proxyPlaneSize;
+	source.baseAddr = gData->proxyBuffer;
+	source.mat = NULL;
+	source.masks = NULL;
+	source.maskPhaseRow = 0;
+	source.maskPhaseCol = 0;
+
+	Boolean converted = colorSpace->ConvertForDisplay != NULL &&
+		colorSpace->ConvertForDisplay(&source,
+									  (Color8*)gData->proxyDisplay,
+									  gData->proxyWidth * kDisplayBytes,
+									  &displayArea) == kSPNoError;
+	sSPBasic->ReleaseSuite(kPSColorSpaceSuite, kPSColorSpaceSuiteVersion2);
+	if (!converted)
+		return false;
+
+	const uint8* alpha = TransparencyPlane();
+	uint8* pixel = (uint8*)gData->proxyDisplay;
+	for (int32 y = 0; y < gData->proxyHeight; y++)
+	{
+		for (int32 x = 0; x < gData->proxyWidth; x++)
+		{
+			uint8 r = pixel[1];
+			uint8 g = pixel[2];
+			uint8 b = pixel[3];
+			if (alpha != NULL)
+			{
+				uint8 a = *alpha++;
+				r = OverChecker(r, a, x, y);
+				g = OverChecker(g, a, x, y);
+				b = OverChecker(b, a, x, y);
+			}
+			pixel[0] = b;
+			pixel[1] = g;
+			pixel[2] = r;
+			pixel[3] = 255;
+			pixel += kDisplayBytes;
+		}
+	}
+	return true;
+}
+
+// gray and RGB planes interleaved to RGBA for displayPixels
+static Boolean CompositeRGBA(void)
+{
+	int32 colors = DisplayColors();
+	if (colors == 0)
+		return false;
+
+	const uint8* planes[3];
+	for (int32 color = 0; color < 3; color++)
+		planes[color] = (const uint8*)gData->proxyBuffer +
+						gData->proxyPlaneSize * (colors == 1 ? 0 : color);
+
+	const uint8* alpha = TransparencyPlane();
+	uint8* display = (uint8*)gData->proxyDisplay;
+	int32 width = gData->proxyWidth;
+	for (int32 y = 0; y < gData->proxyHeight; y++)
+	{
+		int32 row = y * width;
+		for (int32 x = 0; x < width; x++)
+		{
+			uint8 r = planes[0][row + x];
+			uint8 g = planes[1][row + x];
+			uint8 b = planes[2][row + x];
+			if (alpha != NULL)
+			{
+				uint8 a = alpha[row + x];
+				r = OverChecker(r, a, x, y);
+				g = OverChecker(g, a, x, y);
+				b = OverChecker(b, a, x, y);
+			}
+			display[0] = r;
+			display[1] = g;
+			display[2] = b;
+			display[3] = 255;
+			display += kDisplayBytes;
+		}
+	}
+	return true;
+}
+
+//-------------------------------------------------------------------------------
+//
+// UpdateProxyDisplay
+//
+// Nothing happens while the cache holds what proxyBuffer shows for this
+// document's mode and profile, so exposes, dragged over windows and DPI
+// changes cost a blit and no more.
+//
+//-------------------------------------------------------------------------------
+Boolean UpdateProxyDisplay(const VRect* displayArea)
+{
+	// a floating selection's mask isn't laid out like the proxy
+	if (gData->proxyBuffer == NULL || gFilterRecord->isFloating)
+		return false;
+
+	int32 width = gData->proxyWidth;
+	int32 height = gData->proxyHeight;
+	int32 mode = gFilterRecord->imageMode;
+	uint32 profile = gData->proxySourceProfile;
+
+	if (gData->proxyDisplay != NULL &&
+		gData->proxyDisplayGeneration == gData->proxyGeneration &&
+		gData->proxyDisplayWidth == width &&
+		gData->proxyDisplayHeight == height &&
+		gData->proxyDisplayMode == mode &&
+		gData->proxyDisplayProfile == profile)
+		return true;
+
+	// whatever happens next the old contents are gone
+	gData->proxyDisplayWidth = 0;
+	gData->proxyDisplayHeight = 0;
+
+	int64 displaySize;
+	if (!BufferBytes(width, height, kDisplayBytes, displaySize))
+		return false;
+
+	gData->proxyDisplay = ReserveBuffer(gData->proxyDisplayID,
+										gData->proxyDisplayCapacity,
+										displaySize);
+	if (gData->proxyDisplay == NULL)
+		return false;
+
+	Boolean monitor = displayArea != NULL && ConvertToMonitor(*displayArea);
+	if (!monitor && !CompositeRGBA())
+		return false;
+
+	gData->proxyDisplayMonitor = monitor;
+	gData->proxyDisplayGeneration = gData->proxyGeneration;
+	gData->proxyDisplayWidth = width;
+	gData->proxyDisplayHeight = height;
+	gData->proxyDisplayMode = mode;
+	gData->proxyDisplayProfile = profile;
+	return true;
+}
+
+void GetProxyDisplayMap(PSPixelMap& map)
+{
+	VRect inRect = GetInRect();
+
+	map.version = 1;
+	map.bounds.top = inRect.top;
+	map.bounds.left = inRect.left;
+	map.bounds.bottom = inRect.bottom;
+	map.bounds.right = inRect.right;
+	map.imageMode = plugInModeRGBColor;
+	map.rowBytes = gData->proxyWidth * kDisplayBytes;
+	map.colBytes = kDisplayBytes;
+	map.planeBytes = 1;
+	map.baseAddr = gData->proxyDisplay;
+
+	map.mat = NULL;
+	map.masks = NULL;
+	map.maskPhaseRow = 0;
+	map.maskPhaseCol = 0;
+}
+
+Boolean GetProxyDirtyRows(int32 top, int32 dirtyTop, int32 dirtyBottom, VRect& srcRect)
+{
+	int32 first = dirtyTop - top;
+	int32 last = dirtyBottom - top;
+	if (first < 0)
+		first = 0;
+	if (last > gData->proxyHeight)
+		last = gData->proxyHeight;
+	if (first >= last)
+		return false;
+
+	srcRect = GetInRect();
+	srcRect.bottom = srcRect.top + last;
+	srcRect.top += first;
+	return true;
+}
+
+void DeleteProxyDisplay(void)
+{
+	ReleaseBuffer(gData->proxyDisplayID, gData->proxyDisplayCapacity);
+	gData->proxyDisplay = NULL;
+}
+
+// end InvertDisplay.cpp
@@ -0,0 +1,39 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+#ifndef _INVERTDISPLAY_H
+#define _INVERTDISPLAY_H
+
+#include "Invert.h"
+
+// Bring the display cache up to date with proxyBuffer unless it already is.
+// With displayArea, the proxy's screen rectangle, and the host's colour space
+// suite it holds monitor RGB as BGRX and proxyDisplayMonitor is set, the
+// dialog blits it itself. Otherwise gray and RGB are held as RGBA for
+// displayPixels. Returns false when neither works, the planar proxy goes to
+// displayPixels as before then.
+Boolean UpdateProxyDisplay(const VRect* displayArea);
+
+// Hash of the document's ICC profile, taken whenever the proxy source is read
+// and kept in proxySourceProfile for UpdateProxyDisplay to compare.
+uint32 ProxyProfileHash(void);
+
+// A pixel map over an RGBA display cache, bounds from GetInRect.
+void GetProxyDisplayMap(PSPixelMap& map);
+
+// The source rect for displayPixels covering the proxy rows, drawn from top
+// down, that fall between dirtyTop and dirtyBottom. Returns false for none.
+Boolean GetProxyDirtyRows(int32 top, int32 dirtyTop, int32 dirtyBottom, VRect& srcRect);
+
+// Free the display cache, done with the proxy buffer.
+void DeleteProxyDisplay(void);
+
+#endif
+// end InvertDisplay.h
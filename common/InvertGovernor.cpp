@@ -0,0 +1,147 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertGovernor.h"
+#include "InvertArena.h"
+#include "Logger.h"
+
+//-------------------------------------------------------------------------------
+//
+// Memory governor
+//
+// maxSpace says what Photoshop would let us have, not what it has free, and
+// on a machine already near its limit a plan made from it makes the host
+// page or fail. The governor plans from what the buffer procs report free,
+// with some left for everyone else, and looks again every few tiles. All of
+// its levers go through PlanTiles: a smaller budget gives smaller tiles, then
+// no worker pipeline, whose two slots are the only memory the plug-in holds,
+// and then one plane per request. The workers themselves share the slots so
+// their number costs nothing to keep.
+//
+// When the free space drops below what the current plan needs, or rises by
+// a quarter over what it was planned with, the filter loop finishes the
+// tiles it has started and the rest of the area is planned again, unless the
+// plan is already as small as PlanTiles makes them. Every decision goes to
+// the log.
+//
+//-------------------------------------------------------------------------------
+const int32 kGovernorCheckTiles = 8;
+const int32 kGovernorShare = 4;			// plan with 3 quarters of what is free
+const int32 kGovernorGrowth = 4;		// and plan again when that is a quarter up
+
+// the budget free bytes allow, held would be given back by a new plan
+static int64 GovernedBudget(const Governor& governor, int64 free, int64 held)
+{
+	// a host with no space procs reports 0, DoPrepare's budget stands then
+	if (free <= 0)
+		return governor.ceiling;
+
+	int64 usable = free + held;
+	int64 budget = usable - usable / kGovernorShare;
+	return budget < governor.ceiling ? budget : governor.ceiling;
+}
+
+static void LogGovernor(const char* decision, int64 free, int64 budget)
+{
+	Logger logIt("Invert");
+	logIt.Write("Governor ", false);
+	logIt.Write(decision, false);
+	logIt.Write(" free ", false);
+	logIt.Write((double)free, false);
+	logIt.Write(" budget ", false);
+	logIt.Write((double)budget, true);
+}
+
+void StartGovernor(Governor& governor, const VRect& area, int64 ceiling)
+{
+	governor.area = area;
+	governor.ceiling = ceiling;
+	governor.checkEvery = kGovernorCheckTiles;
+	governor.sinceCheck = 0;
+	governor.band = -1;
+	governor.replans = 0;
+
+	// DoStart has already taken the session arena out of what is free
+	ArenaUsage arena;
+	GetArenaUsage(arena);
+
+	int64 free = HostBufferSpace64(gFilterRecord->bufferProcs);
+	governor.budget = GovernedBudget(governor, free, arena.reserved);
+	LogGovernor("start", free, governor.budget);
+}
+
+Boolean GovernorWantsReplan(Governor& governor, const TilePlan& plan, int32 tile)
+{
+	// the tiles above have all been asked for, so a new plan can start here
+	int32 band = tile / plan.tilesHoriz;
+	Boolean newBand = band != governor.band;
+	governor.band = band;
+
+	if (++governor.sinceCheck < governor.checkEvery || !newBand || tile == 0)
+		return false;
+	governor.sinceCheck = 0;
+
+	int64 free = HostBufferSpace64(gFilterRecord->bufferProcs);
+	int64 needed = plan.hostBytes + plan.bufferBytes;
+	int64 budget = GovernedBudget(governor, free, needed);
+
+	const char* decision = NULL;
+	if (budget < needed)
+	{
+		// once the plan is down to one plane of one host tile there is
+		// nothing smaller to go to, planning again would only stall the loop
+		TilePlan smaller;
+		PlanTiles(smaller, plan.area, budget);
+		if (smaller.hostBytes + smaller.bufferBytes >= needed)
+			return false;
+		decision = "shrink";
+	}
+	else if (governor.budget < governor.ceiling &&
+			 (budget == governor.ceiling || budget - governor.budget > governor.budget / kGovernorGrowth))
+		decision = "grow";
+	if (decision == NULL)
+		return false;
+
+	LogGovernor(decision, free, budget);
+	governor.budget = budget;
+	governor.replans++;
+	return true;
+}
+
+void GovernorPlanned(Governor& governor, const TilePlan& plan)
+{
+	governor.band = -1;
+
+	Logger logIt("Invert");
+	logIt.Write("Governor plan from row ", false);
+	logIt.Write(plan.area.top, false);
+	logIt.Write(" tile ", false);
+	logIt.Write(plan.tileWidth, false);
+	logIt.Write(" x ", false);
+	logIt.Write(plan.tileHeight, false);
+	logIt.Write(plan.pipeline ? " pipeline" : "", false);
+	logIt.Write(plan.allPlanes ? " all planes" : " one plane", false);
+	logIt.Write(" needs ", false);
+	logIt.Write((double)(plan.hostBytes + plan.bufferBytes), false);
+	logIt.Write(" of ", false);
+	logIt.Write((double)governor.budget, true);
+}
+
+void GovernorProgress(const Governor& governor, const TilePlan& plan, int32 tile)
+{
+	VRect tileRect = GetTileRect(plan, tile);
+	int32 column = tile % plan.tilesHoriz + 1;
+	int32 done = tileRect.top - governor.area.top +
+				 (int32)((int64)(tileRect.bottom - tileRect.top) * column / plan.tilesHoriz);
+	gFilterRecord->progressProc(done, governor.area.bottom - governor.area.top);
+}
+
+// end InvertGovernor.cpp
@@ -0,0 +1,45 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+#ifndef _INVERTGOVERNOR_H
+#define _INVERTGOVERNOR_H
+
+#include "Invert.h"
+#include "InvertTiles.h"
+
+// how much memory the filter loop may plan with while it runs
+typedef struct Governor
+{
+	VRect area;				// the whole filter area, for progress
+	int64 ceiling;			// DoPrepare's budget, never planned past
+	int64 budget;			// what the current plan was made with
+	int32 checkEvery;		// tiles between looks at the host's free space
+	int32 sinceCheck;
+	int32 band;				// tile row of the last tile looked at
+	int32 replans;
+} Governor;
+
+// Look at the free space and set the first budget for area.
+void StartGovernor(Governor& governor, const VRect& area, int64 ceiling);
+
+// Called before each tile of plan is fetched. True when the free space has
+// moved far enough that the rest of the area, from the top of tile's row of
+// tiles down, should be planned again with the new governor.budget. Only the
+// first tile fetched from a row can stop the loop.
+Boolean GovernorWantsReplan(Governor& governor, const TilePlan& plan, int32 tile);
+
+// Log the plan made with the current budget, before its first tile.
+void GovernorPlanned(Governor& governor, const TilePlan& plan);
+
+// progressProc for tile of plan done, in rows of the whole area
+void GovernorProgress(const Governor& governor, const TilePlan& plan, int32 tile);
+
+#endif
+// end InvertGovernor.h
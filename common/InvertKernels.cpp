@@ -0,0 +1,1282 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertKernels.h"
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define INVERT_X86 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#endif
+#else
+	#define INVERT_X86 0
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#endif
+#endif
+
+// MSVC lets us use any intrinsic anywhere, clang and gcc want to be told
+#if defined(_MSC_VER)
+	#define INVERT_TARGET(x)
+#else
+	#define INVERT_TARGET(x) __attribute__((target(x)))
+#endif
+
+InvertKernels gKernels = { isaScalar, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+
+//-------------------------------------------------------------------------------
+//
+// Scalar kernels
+//
+// The reference implementation. Every vector kernel must produce exactly the
+// same bits as these. VerifyInvertKernels checks that in debug builds, and
+// test/InvertKernelsTest checks it for every instruction set the machine has.
+//
+//-------------------------------------------------------------------------------
+static void InvertRun8Scalar(void* data, int32 count)
+{
+	uint8* pixel = (uint8*)data;
+	for (int32 x = 0; x < count; x++)
+		pixel[x] = UINT8_MAX - pixel[x];
+}
+
+static void InvertRun16Scalar(void* data, int32 count)
+{
+	uint16* pixel = (uint16*)data;
+	for (int32 x = 0; x < count; x++)
+		pixel[x] = UINT16_MAX - pixel[x];
+}
+
+static void InvertRun32Scalar(void* data, int32 count)
+{
+	float* pixel = (float*)data;
+	for (int32 x = 0; x < count; x++)
+		pixel[x] = (float)(1.0 - pixel[x]);
+}
+
+#if INVERT_X86
+
+//-------------------------------------------------------------------------------
+//
+// SSE2 kernels
+//
+// For unsigned integers max - x is the same as x ^ max, so the 8 and 16 bit
+// kernels are one xor per vector. 1.0f - x in single precision rounds to the
+// same value as the scalar double precision expression.
+//
+//-------------------------------------------------------------------------------
+INVERT_TARGET("sse2")
+static void InvertRunBytesSSE2(uint8* pixel, int32 bytes)
+{
+	const __m128i ones = _mm_set1_epi32(-1);
+	int32 x = 0;
+	for (; x + 16 <= bytes; x += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(pixel + x));
+		_mm_storeu_si128((__m128i*)(pixel + x), _mm_xor_si128(v, ones));
+	}
+	InvertRun8Scalar(pixel + x, bytes - x);
+}
+
+INVERT_TARGET("sse2")
+static void InvertRun8SSE2(void* data, int32 count)
+{
+	InvertRunBytesSSE2((uint8*)data, count);
+}
+
+INVERT_TARGET("sse2")
+static void InvertRun16SSE2(void* data, int32 count)
+{
+	// a 16 bit sample is two bytes and the xor doesn't care where they split
+	InvertRunBytesSSE2((uint8*)data, count * 2);
+}
+
+INVERT_TARGET("sse2")
+static void InvertRun32SSE2(void* data, int32 count)
+{
+	float* pixel = (float*)data;
+	const __m128 one = _mm_set1_ps(1.0f);
+	int32 x = 0;
+	for (; x + 4 <= count; x += 4)
+		_mm_storeu_ps(pixel + x, _mm_sub_ps(one, _mm_loadu_ps(pixel + x)));
+	InvertRun32Scalar(pixel + x, count - x);
+}
+
+//-------------------------------------------------------------------------------
+//
+// AVX2 kernels
+//
+//-------------------------------------------------------------------------------
+INVERT_TARGET("avx2")
+static void InvertRunBytesAVX2(uint8* pixel, int32 bytes)
+{
+	const __m256i ones = _mm256_set1_epi32(-1);
+	int32 x = 0;
+	for (; x + 32 <= bytes; x += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(pixel + x));
+		_mm256_storeu_si256((__m256i*)(pixel + x), _mm256_xor_si256(v, ones));
+	}
+	InvertRunBytesSSE2(pixel + x, bytes - x);
+}
+
+INVERT_TARGET("avx2")
+static void InvertRun8AVX2(void* data, int32 count)
+{
+	InvertRunBytesAVX2((uint8*)data, count);
+}
+
+INVERT_TARGET("avx2")
+static void InvertRun16AVX2(void* data, int32 count)
+{
+	InvertRunBytesAVX2((uint8*)data, count * 2);
+}
+
+INVERT_TARGET("avx2")
+static void InvertRun32AVX2(void* data, int32 count)
+{
+	float* pixel = (float*)data;
+	const __m256 one = _mm256_set1_ps(1.0f);
+	int32 x = 0;
+	for (; x + 8 <= count; x += 8)
+		_mm256_storeu_ps(pixel + x, _mm256_sub_ps(one, _mm256_loadu_ps(pixel + x)));
+	InvertRun32SSE2(pixel + x, count - x);
+}
+
+//-------------------------------------------------------------------------------
+//
+// AVX-512 kernels
+//
+// Only AVX-512F instructions are used so we don't need to check for BW.
+//
+//-------------------------------------------------------------------------------
+INVERT_TARGET("avx512f")
+static void InvertRunBytesAVX512(uint8* pixel, int32 bytes)
+{
+	const __m512i ones = _mm512_set1_epi32(-1);
+	int32 x = 0;
+	for (; x + 64 <= bytes; x += 64)
+	{
+		__m512i v = _mm512_loadu_si512((const void*)(pixel + x));
+		_mm512_storeu_si512((void*)(pixel + x), _mm512_xor_si512(v, ones));
+	}
+	InvertRunBytesAVX2(pixel + x, bytes - x);
+}
+
+INVERT_TARGET("avx512f")
+static void InvertRun8AVX512(void* data, int32 count)
+{
+	InvertRunBytesAVX512((uint8*)data, count);
+}
+
+INVERT_TARGET("avx512f")
+static void InvertRun16AVX512(void* data, int32 count)
+{
+	InvertRunBytesAVX512((uint8*)data, count * 2);
+}
+
+INVERT_TARGET("avx512f")
+static void InvertRun32AVX512(void* data, int32 count)
+{
+	float* pixel = (float*)data;
+	const __m512 one = _mm512_set1_ps(1.0f);
+	int32 x = 0;
+	for (; x + 16 <= count; x += 16)
+		_mm512_storeu_ps(pixel + x, _mm512_sub_ps(one, _mm512_loadu_ps(pixel + x)));
+	InvertRun32AVX2(pixel + x, count - x);
+}
+
+#endif // INVERT_X86
+
+//-------------------------------------------------------------------------------
+//
+// Depth conversion
+//
+// The proxy is drawn from an 8 bit copy of the source. 16 bit samples run
+// from 0 to 32768, so the nearest 8 bit value is (v * 255 + 16384) >> 15,
+// which the vector kernels get as (v << 8) - v in 32 bit lanes. Floats are
+// clamped to 0..1, NaN going to 0, then scaled and rounded. Dithering swaps the
+// rounding half for a threshold from a 4 by 4 Bayer matrix, so a smooth high
+// bit depth ramp doesn't band in the preview. The matrix repeats every four
+// samples, and the vector loops always step by a multiple of four, so the
+// scalar tails stay in phase.
+//
+//-------------------------------------------------------------------------------
+static const uint8 kBayer4[4][4] =
+{
+	{ 0, 8, 2, 10 },
+	{ 12, 4, 14, 6 },
+	{ 3, 11, 1, 9 },
+	{ 15, 7, 13, 5 }
+};
+
+const int32 kRound16 = 1 << 14;
+const float kRound32 = 0.5f;
+
+// threshold b of 16, as a fraction of one 8 bit step
+static inline int32 Dither16(uint8 b)
+{
+	return (2 * b + 1) << 10;
+}
+
+static inline float Dither32(uint8 b)
+{
+	return (b + 0.5f) / 16.0f;
+}
+
+static void Convert8To8(const void* source, uint8* destination, int32 count, const uint8* /*dither*/)
+{
+	memcpy(destination, source, count);
+}
+
+static void Convert16To8Scalar(const void* source, uint8* destination, int32 count, const uint8* dither)
+{
+	const uint16* sample = (const uint16*)source;
+	for (int32 x = 0; x < count; x++)
+	{
+		int32 offset = dither != NULL ? Dither16(dither[x & 3]) : kRound16;
+		int32 value = ((int32)sample[x] * 255 + offset) >> 15;
+		destination[x] = (uint8)(value > UINT8_MAX ? UINT8_MAX : value);
+	}
+}
+
+static void Convert32To8Scalar(const void* source, uint8* destination, int32 count, const uint8* dither)
+{
+	const float* sample = (const float*)source;
+	for (int32 x = 0; x < count; x++)
+	{
+		float offset = dither != NULL ? Dither32(dither[x & 3]) : kRound32;
+		float value = sample[x] > 0.0f ? sample[x] : 0.0f;
+		value = value < 1.0f ? value : 1.0f;
+		float scaled = value * 255.0f + offset;
+		int32 rounded = (int32)scaled;
+		destination[x] = (uint8)(rounded > UINT8_MAX ? UINT8_MAX : rounded);
+	}
+}
+
+#if INVERT_X86
+
+INVERT_TARGET("sse2")
+static void Convert16To8SSE2(const void* source, uint8* destination, int32 count, const uint8* dither)
+{
+	const uint16* sample = (const uint16*)source;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i offset = dither != NULL ?
+		_mm_set_epi32(Dither16(dither[3]), Dither16(dither[2]), Dither16(dither[1]), Dither16(dither[0])) :
+		_mm_set1_epi32(kRound16);
+	int32 x = 0;
+	for (; x + 8 <= count; x += 8)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(sample + x));
+		__m128i lo = _mm_unpacklo_epi16(v, zero);
+		__m128i hi = _mm_unpackhi_epi16(v, zero);
+		lo = _mm_srli_epi32(_mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(lo, 8), lo), offset), 15);
+		hi = _mm_srli_epi32(_mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(hi, 8), hi), offset), 15);
+		// at most 511, the unsigned pack clamps it to 255
+		__m128i packed = _mm_packus_epi16(_mm_packs_epi32(lo, hi), zero);
+		_mm_storel_epi64((__m128i*)(destination + x), packed);
+	}
+	Convert16To8Scalar(sample + x, destination + x, count - x, dither);
+}
+
+INVERT_TARGET("sse2")
+static void Convert32To8SSE2(const void* source, uint8* destination, int32 count, const uint8* dither)
+{
+	const float* sample = (const float*)source;
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(255.0f);
+	const __m128 offset = dither != NULL ?
+		_mm_set_ps(Dither32(dither[3]), Dither32(dither[2]), Dither32(dither[1]), Dither32(dither[0])) :
+		_mm_set1_ps(kRound32);
+	int32 x = 0;
+	for (; x + 8 <= count; x += 8)
+	{
+		// max returns its second operand for NaN, which makes it 0
+		__m128 lo = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(sample + x), zero), one);
+		__m128 hi = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(sample + x + 4), zero), one);
+		__m128i loInt = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(lo, scale), offset));
+		__m128i hiInt = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(hi, scale), offset));
+		__m128i packed = _mm_packus_epi16(_mm_packs_epi32(loInt, hiInt), _mm_setzero_si128());
+		_mm_storel_epi64((__m128i*)(destination + x), packed);
+	}
+	Convert32To8Scalar(sample + x, destination + x, count - x, dither);
+}
+
+INVERT_TARGET("avx2")
+static inline void StoreConverted8AVX2(uint8* destination, __m256i lo, __m256i hi)
+{
+	__m256i words = _mm256_packs_epi32(lo, hi);
+	__m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+	// packs works within 128 bit lanes, put the four groups of four back in order
+	packed = _mm_shuffle_epi32(packed, _MM_SHUFFLE(3, 1, 2, 0));
+	_mm_storeu_si128((__m128i*)destination, packed);
+}
+
+INVERT_TARGET("avx2")
+static void Convert16To8AVX2(const void* source, uint8* destination, int32 count, const uint8* dither)
+{
+	const uint16* sample = (const uint16*)source;
+	const __m256i offset = dither != NULL ?
+		_mm256_set_epi32(Dither16(dither[3]), Dither16(dither[2]), Dither16(dither[1]), Dither16(dither[0]),
+						 Dither16(dither[3]), Dither16(dither[2]), Dither16(dither[1]), Dither16(dither[0])) :
+		_mm256_set1_epi32(kRound16);
+	int32 x = 0;
+	for (; x + 16 <= count; x += 16)
+	{
+		__m256i lo = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(sample + x)));
+		__m256i hi = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(sample + x + 8)));
+		lo = _mm256_srli_epi32(_mm256_add_epi32(_mm256_sub_epi32(_mm256_slli_epi32(lo, 8), lo), offset), 15);
+		hi = _mm256_srli_epi32(_mm256_add_epi32(_mm256_sub_epi32(_mm256_slli_epi32(hi, 8), hi), offset), 15);
+		StoreConverted8AVX2(destination + x, lo, hi);
+	}
+	Convert16To8SSE2(sample + x, destination + x, count - x, dither);
+}
+
+INVERT_TARGET("avx2")
+static void Convert32To8AVX2(const void* source, uint8* destination, int32 count, const uint8* dither)
+{
+	const float* sample = (const float*)source;
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 scale = _mm256_set1_ps(255.0f);
+	const __m256 offset = dither != NULL ?
+		_mm256_set_ps(Dither32(dither[3]), Dither32(dither[2]), Dither32(dither[1]), Dither32(dither[0]),
+					  Dither32(dither[3]), Dither32(dither[2]), Dither32(dither[1]), Dither32(dither[0])) :
+		_mm256_set1_ps(kRound32);
+	int32 x = 0;
+	for (; x + 16 <= count; x += 16)
+	{
+		__m256 lo = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(sample + x), zero), one);
+		__m256 hi = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(sample + x + 8), zero), one);
+		StoreConverted8AVX2(destination + x,
+			_mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(lo, scale), offset)),
+			_mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(hi, scale), offset)));
+	}
+	Convert32To8SSE2(sample + x, destination + x, count - x, dither);
+}
+
+#endif // INVERT_X86
+
+//-------------------------------------------------------------------------------
+//
+// Random decisions
+//
+// Philox2x32-10, a counter based generator: the draw for a pixel is a pure
+// function of the seed and the pixel's document coordinate, so any tile, row
+// or proxy pixel can be decided on its own, in any order, and always comes out
+// the same. One block, counter (x / 4, y) and key seed, gives 64 bits which are
+// the 16 bit draws of four neighbouring pixels, low half of the first word
+// first. The vector kernels run four or eight blocks at once and must match
+// the scalar kernel bit for bit.
+//
+//-------------------------------------------------------------------------------
+const uint32 kPhiloxMultiplier = 0xD256D193;
+const uint32 kPhiloxWeyl = 0x9E3779B9;
+const int32 kPhiloxRounds = 10;
+
+static inline void PhiloxBlock(uint32 seed, uint32 block, uint32 y, uint32 words[2])
+{
+	uint32 c0 = block;
+	uint32 c1 = y;
+	uint32 key = seed;
+	for (int32 round = 0; round < kPhiloxRounds; round++)
+	{
+		uint64 product = (uint64)kPhiloxMultiplier * c0;
+		c0 = (uint32)(product >> 32) ^ key ^ c1;
+		c1 = (uint32)product;
+		key += kPhiloxWeyl;
+	}
+	words[0] = c0;
+	words[1] = c1;
+}
+
+//-------------------------------------------------------------------------------
+//
+// Bit masks
+//
+// Decisions and the selection they are combined with are kept a bit per
+// pixel, 64 pixels to a word. A chunk of a row is an eighth of the memory it
+// was as bytes, the two combine a word at a time, and the tile kernels pass
+// over a word with nothing set without looking at its pixels. The kernels
+// below fill a range of pixels into words cleared beforehand so the vector
+// ones can hand their ragged ends to the scalar one.
+//
+//-------------------------------------------------------------------------------
+static inline void ClearMaskBits(InvertMaskWord* bits, int32 count)
+{
+	memset(bits, 0, MaskWords(count) * sizeof(InvertMaskWord));
+}
+
+// or the n low bits of value, n at most 32, in from pixel d on
+static inline void PutMaskBits(InvertMaskWord* bits, int32 d, uint32 value, int32 n)
+{
+	int32 shift = d & (kMaskWordBits - 1);
+	bits[d / kMaskWordBits] |= (InvertMaskWord)value << shift;
+	if (shift + n > kMaskWordBits)
+		bits[d / kMaskWordBits + 1] |= (InvertMaskWord)value >> (kMaskWordBits - shift);
+}
+
+static inline int32 LowestBit(InvertMaskWord word)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return (int32)index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanForward(&index, (unsigned long)word))
+		return (int32)index;
+	_BitScanForward(&index, (unsigned long)(word >> 32));
+	return (int32)index + 32;
+#else
+	return __builtin_ctzll(word);
+#endif
+}
+
+// the first pixel from start on whose bit is set, or clear, count if none
+static inline int32 NextMaskBit(const InvertMaskWord* bits, int32 start, int32 count, bool set)
+{
+	if (start >= count)
+		return count;
+
+	int32 w = start / kMaskWordBits;
+	int32 words = MaskWords(count);
+	InvertMaskWord flip = set ? 0 : ~(InvertMaskWord)0;
+	InvertMaskWord word = (bits[w] ^ flip) & (~(InvertMaskWord)0 << (start & (kMaskWordBits - 1)));
+	while (word == 0)
+	{
+		if (++w >= words)
+			return count;
+		word = bits[w] ^ flip;
+	}
+
+	int32 bit = w * kMaskWordBits + LowestBit(word);
+	return bit < count ? bit : count;
+}
+
+static void DecideBitsScalar(const InvertPick& pick,
+							 int32 x,
+							 int32 y,
+							 InvertMaskWord* decisions,
+							 int32 first,
+							 int32 count)
+{
+	uint32 words[2];
+	uint32 block = 0;
+	for (int32 d = first; d < count; d++)
+	{
+		uint32 px = (uint32)(x + d * pick.step);
+		if (d == first || (px >> 2) != block)
+		{
+			block = px >> 2;
+			PhiloxBlock(pick.seed, block, (uint32)y, words);
+		}
+		uint32 word = words[(px >> 1) & 1];
+		uint32 draw = (px & 1) ? word >> 16 : word & 0xFFFF;
+		if (draw < pick.threshold)
+			decisions[d / kMaskWordBits] |= (InvertMaskWord)1 << (d & (kMaskWordBits - 1));
+	}
+}
+
+static void InvertDecideScalar(const InvertPick& pick,
+							   int32 x,
+							   int32 y,
+							   InvertMaskWord* decisions,
+							   int32 count)
+{
+	ClearMaskBits(decisions, count);
+	DecideBitsScalar(pick, x, y, decisions, 0, count);
+}
+
+static void PackMaskBitsScalar(const uint8* mask, InvertMaskWord* bits, int32 first, int32 count)
+{
+	for (int32 d = first; d < count; d++)
+		if (mask[d] != 0)
+			bits[d / kMaskWordBits] |= (InvertMaskWord)1 << (d & (kMaskWordBits - 1));
+}
+
+static void PackMaskScalar(const uint8* mask, InvertMaskWord* bits, int32 count)
+{
+	ClearMaskBits(bits, count);
+	PackMaskBitsScalar(mask, bits, 0, count);
+}
+
+#if INVERT_X86
+
+// there is no unsigned 16 bit compare before AVX-512, flipping the sign bit
+// of both sides turns it into a signed one
+#define INVERT_SIGN16 ((short)0x8000)
+
+INVERT_TARGET("sse2")
+static inline void PhiloxSSE2(__m128i& c0, __m128i& c1, uint32 seed)
+{
+	const __m128i multiplier = _mm_set1_epi32((int)kPhiloxMultiplier);
+	uint32 key = seed;
+	for (int32 round = 0; round < kPhiloxRounds; round++)
+	{
+		// 32 x 32 -> 64 only exists for the even lanes, do the odd ones shifted
+		__m128i even = _mm_mul_epu32(c0, multiplier);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(c0, 32), multiplier);
+		even = _mm_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 2, 0));
+		odd = _mm_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 2, 0));
+		__m128i lo = _mm_unpacklo_epi32(even, odd);
+		__m128i hi = _mm_unpackhi_epi32(even, odd);
+		c0 = _mm_xor_si128(_mm_xor_si128(hi, _mm_set1_epi32((int)key)), c1);
+		c1 = lo;
+		key += kPhiloxWeyl;
+	}
+}
+
+INVERT_TARGET("sse2")
+static void DecideBitsSSE2(const InvertPick& pick,
+						   int32 x,
+						   int32 y,
+						   InvertMaskWord* decisions,
+						   int32 first,
+						   int32 count)
+{
+	if (pick.step != 1)
+	{
+		DecideBitsScalar(pick, x, y, decisions, first, count);
+		return;
+	}
+
+	// line up on a block boundary, then 16 pixels per pass
+	int32 d = first + ((4 - ((x + first) & 3)) & 3);
+	if (d > count)
+		d = count;
+	DecideBitsScalar(pick, x, y, decisions, first, d);
+
+	const __m128i sign = _mm_set1_epi16(INVERT_SIGN16);
+	const __m128i limit = _mm_xor_si128(_mm_set1_epi16((short)pick.threshold), sign);
+	const __m128i lanes = _mm_set_epi32(3, 2, 1, 0);
+
+	for (; d + 16 <= count; d += 16)
+	{
+		__m128i c0 = _mm_add_epi32(_mm_set1_epi32((int)((uint32)(x + d) >> 2)), lanes);
+		__m128i c1 = _mm_set1_epi32(y);
+		PhiloxSSE2(c0, c1, pick.seed);
+
+		// pair each block's words up again, blocks 0 and 1 then 2 and 3
+		__m128i first = _mm_xor_si128(_mm_unpacklo_epi32(c0, c1), sign);
+		__m128i second = _mm_xor_si128(_mm_unpackhi_epi32(c0, c1), sign);
+		__m128i picked = _mm_packs_epi16(_mm_cmplt_epi16(first, limit),
+										 _mm_cmplt_epi16(second, limit));
+		PutMaskBits(decisions, d, (uint32)_mm_movemask_epi8(picked), 16);
+	}
+
+	DecideBitsScalar(pick, x, y, decisions, d, count);
+}
+
+INVERT_TARGET("sse2")
+static void InvertDecideSSE2(const InvertPick& pick,
+							 int32 x,
+							 int32 y,
+							 InvertMaskWord* decisions,
+							 int32 count)
+{
+	ClearMaskBits(decisions, count);
+	DecideBitsSSE2(pick, x, y, decisions, 0, count);
+}
+
+INVERT_TARGET("sse2")
+static void PackMaskSSE2(const uint8* mask, InvertMaskWord* bits, int32 count)
+{
+	ClearMaskBits(bits, count);
+
+	const __m128i zero = _mm_setzero_si128();
+	int32 d = 0;
+	for (; d + 16 <= count; d += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(mask + d));
+		uint32 unselected = (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+		PutMaskBits(bits, d, ~unselected & 0xFFFF, 16);
+	}
+
+	PackMaskBitsScalar(mask, bits, d, count);
+}
+
+INVERT_TARGET("avx2")
+static inline void PhiloxAVX2(__m256i& c0, __m256i& c1, uint32 seed)
+{
+	const __m256i multiplier = _mm256_set1_epi32((int)kPhiloxMultiplier);
+	uint32 key = seed;
+	for (int32 round = 0; round < kPhiloxRounds; round++)
+	{
+		__m256i even = _mm256_mul_epu32(c0, multiplier);
+		__m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(c0, 32), multiplier);
+		even = _mm256_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 2, 0));
+		odd = _mm256_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 2, 0));
+		__m256i lo = _mm256_unpacklo_epi32(even, odd);
+		__m256i hi = _mm256_unpackhi_epi32(even, odd);
+		c0 = _mm256_xor_si256(_mm256_xor_si256(hi, _mm256_set1_epi32((int)key)), c1);
+		c1 = lo;
+		key += kPhiloxWeyl;
+	}
+}
+
+INVERT_TARGET("avx2")
+static void InvertDecideAVX2(const InvertPick& pick,
+							 int32 x,
+							 int32 y,
+							 InvertMaskWord* decisions,
+							 int32 count)
+{
+	ClearMaskBits(decisions, count);
+	if (pick.step != 1)
+	{
+		DecideBitsScalar(pick, x, y, decisions, 0, count);
+		return;
+	}
+
+	int32 d = (4 - (x & 3)) & 3;
+	if (d > count)
+		d = count;
+	DecideBitsScalar(pick, x, y, decisions, 0, d);
+
+	const __m256i sign = _mm256_set1_epi16(INVERT_SIGN16);
+	const __m256i limit = _mm256_xor_si256(_mm256_set1_epi16((short)pick.threshold), sign);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	// the unpacks and the pack both work within 128 bit halves, which leaves
+	// blocks 0 to 3 in the low half and 4 to 7 in the high half, in order
+	for (; d + 32 <= count; d += 32)
+	{
+		__m256i c0 = _mm256_add_epi32(_mm256_set1_epi32((int)((uint32)(x + d) >> 2)), lanes);
+		__m256i c1 = _mm256_set1_epi32(y);
+		PhiloxAVX2(c0, c1, pick.seed);
+
+		__m256i first = _mm256_xor_si256(_mm256_unpacklo_epi32(c0, c1), sign);
+		__m256i second = _mm256_xor_si256(_mm256_unpackhi_epi32(c0, c1), sign);
+		__m256i picked = _mm256_packs_epi16(_mm256_cmpgt_epi16(limit, first),
+											_mm256_cmpgt_epi16(limit, second));
+		PutMaskBits(decisions, d, (uint32)_mm256_movemask_epi8(picked), 32);
+	}
+
+	DecideBitsSSE2(pick, x, y, decisions, d, count);
+}
+
+INVERT_TARGET("avx2")
+static void PackMaskAVX2(const uint8* mask, InvertMaskWord* bits, int32 count)
+{
+	ClearMaskBits(bits, count);
+
+	const __m256i zero = _mm256_setzero_si256();
+	int32 d = 0;
+	for (; d + 32 <= count; d += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(mask + d));
+		uint32 unselected = (uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero));
+		PutMaskBits(bits, d, ~unselected, 32);
+	}
+
+	PackMaskBitsScalar(mask, bits, d, count);
+}
+
+#endif // INVERT_X86
+
+//-------------------------------------------------------------------------------
+//
+// InvertThreshold
+//
+// Turn a percentage into the 16 bit draw limit the decide kernels compare
+// against. 100 percent has no limit that fits, callers skip the draws then.
+//
+//-------------------------------------------------------------------------------
+uint32 InvertThreshold(int16 percent)
+{
+	if (percent <= 0)
+		return 0;
+	if (percent >= 100)
+		return 0x10000;
+	return ((uint32)percent << 16) / 100;
+}
+
+//-------------------------------------------------------------------------------
+//
+// DetectInvertISA
+//
+// Ask the CPU, and the OS for the wider register files, what we can run.
+//
+//-------------------------------------------------------------------------------
+InvertISA DetectInvertISA(void)
+{
+#if INVERT_X86
+	#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+
+		__cpuid(info, 1);
+		bool sse2 = (info[3] & (1 << 26)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+
+		bool avx2 = false;
+		bool avx512 = false;
+		if (maxLeaf >= 7)
+		{
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+			avx512 = (info[1] & (1 << 16)) != 0;
+		}
+
+		unsigned __int64 xcr0 = osxsave ? _xgetbv(0) : 0;
+		bool ymmState = (xcr0 & 0x06) == 0x06;
+		bool zmmState = (xcr0 & 0xE6) == 0xE6;
+
+		if (avx512 && zmmState)
+			return isaAVX512;
+		if (avx && avx2 && ymmState)
+			return isaAVX2;
+		if (sse2)
+			return isaSSE2;
+	#else
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+			return isaAVX512;
+		if (__builtin_cpu_supports("avx2"))
+			return isaAVX2;
+		if (__builtin_cpu_supports("sse2"))
+			return isaSSE2;
+	#endif
+#endif
+	return isaScalar;
+}
+
+//-------------------------------------------------------------------------------
+//
+// SelectInvertKernels
+//
+// Fill in the kernel table for the requested instruction set. Asking for
+// something this build does not have gets you the scalar kernels.
+//
+//-------------------------------------------------------------------------------
+void SelectInvertKernels(InvertKernels& kernels, InvertISA isa)
+{
+	kernels.isa = isaScalar;
+	kernels.invert8 = InvertRun8Scalar;
+	kernels.invert16 = InvertRun16Scalar;
+	kernels.invert32 = InvertRun32Scalar;
+	kernels.decide = InvertDecideScalar;
+	kernels.packMask = PackMaskScalar;
+	kernels.convert16 = Convert16To8Scalar;
+	kernels.convert32 = Convert32To8Scalar;
+
+#if INVERT_X86
+	switch (isa)
+	{
+		case isaAVX512:
+			kernels.isa = isaAVX512;
+			kernels.invert8 = InvertRun8AVX512;
+			kernels.invert16 = InvertRun16AVX512;
+			kernels.invert32 = InvertRun32AVX512;
+			kernels.decide = InvertDecideAVX2;
+			kernels.packMask = PackMaskAVX2;
+			kernels.convert16 = Convert16To8AVX2;
+			kernels.convert32 = Convert32To8AVX2;
+			break;
+		case isaAVX2:
+			kernels.isa = isaAVX2;
+			kernels.invert8 = InvertRun8AVX2;
+			kernels.invert16 = InvertRun16AVX2;
+			kernels.invert32 = InvertRun32AVX2;
+			kernels.decide = InvertDecideAVX2;
+			kernels.packMask = PackMaskAVX2;
+			kernels.convert16 = Convert16To8AVX2;
+			kernels.convert32 = Convert32To8AVX2;
+			break;
+		case isaSSE2:
+			kernels.isa = isaSSE2;
+			kernels.invert8 = InvertRun8SSE2;
+			kernels.invert16 = InvertRun16SSE2;
+			kernels.invert32 = InvertRun32SSE2;
+			kernels.decide = InvertDecideSSE2;
+			kernels.packMask = PackMaskSSE2;
+			kernels.convert16 = Convert16To8SSE2;
+			kernels.convert32 = Convert32To8SSE2;
+			break;
+		default:
+			break;
+	}
+#else
+	(void)isa;
+#endif
+}
+
+//-------------------------------------------------------------------------------
+//
+// GetInvertRunProc
+//
+// Map an image depth to the matching kernel.
+//
+//-------------------------------------------------------------------------------
+InvertRunProc GetInvertRunProc(const InvertKernels& kernels, int32 depth)
+{
+	if (depth == 32)
+		return kernels.invert32;
+	else if (depth == 16)
+		return kernels.invert16;
+	return kernels.invert8;
+}
+
+//-------------------------------------------------------------------------------
+//
+// GetConvertRowProc
+//
+// The 8 bit copy for a source depth, chosen once per read, not per row.
+//
+//-------------------------------------------------------------------------------
+ConvertRowProc GetConvertRowProc(const InvertKernels& kernels, int32 depth)
+{
+	if (depth == 32)
+		return kernels.convert32;
+	else if (depth == 16)
+		return kernels.convert16;
+	return Convert8To8;
+}
+
+//-------------------------------------------------------------------------------
+//
+// OrderedDitherRow
+//
+// The four thresholds for row y, to hand to a ConvertRowProc.
+//
+//-------------------------------------------------------------------------------
+const uint8* OrderedDitherRow(int32 y)
+{
+	return kBayer4[y & 3];
+}
+
+//-------------------------------------------------------------------------------
+//
+// Mask spans
+//
+// Selections are mostly long runs of 0 and 255 with a thin band of partial
+// values along the edges. NextMaskSpan walks a mask row one run at a time and
+// uses 16 byte compares to get through the long runs.
+//
+//-------------------------------------------------------------------------------
+static inline MaskSpanKind MaskKind(uint8 maskValue)
+{
+	if (maskValue == 0)
+		return spanSkip;
+	else if (maskValue == UINT8_MAX)
+		return spanFull;
+	return spanPartial;
+}
+
+#if INVERT_X86
+INVERT_TARGET("sse2")
+static int32 ScanMaskSSE2(const uint8* mask, int32 x, int32 width, MaskSpanKind kind)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i full = _mm_set1_epi32(-1);
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(mask + x));
+		int32 isZero = _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+		int32 isFull = _mm_movemask_epi8(_mm_cmpeq_epi8(v, full));
+		int32 same = kind == spanSkip ? isZero :
+					 kind == spanFull ? isFull :
+					 ~(isZero | isFull) & 0xFFFF;
+		if (same != 0xFFFF)
+			break;
+	}
+	return x;
+}
+#endif
+
+int32 NextMaskSpan(const InvertKernels& kernels,
+				   const uint8* mask,
+				   int32 start,
+				   int32 width,
+				   MaskSpanKind& kind)
+{
+	kind = MaskKind(mask[start]);
+	int32 x = start + 1;
+
+#if INVERT_X86
+	if (kernels.isa != isaScalar)
+		x = ScanMaskSSE2(mask, x, width, kind);
+#else
+	(void)kernels;
+#endif
+
+	while (x < width && MaskKind(mask[x]) == kind)
+		x++;
+	return x;
+}
+
+//-------------------------------------------------------------------------------
+//
+// Tile kernels
+//
+// One template per pixel type and mask policy. The policy is known at compile
+// time so the row loops carry no depth or mask tests. Unmasked rows go
+// straight to the vector run kernels. Masked rows are split into spans: skip
+// spans cost nothing and the rest are inverted in bulk. Partial spans are
+// inverted like full ones here. On the advanceState path the host blends
+// them by the mask afterwards; the channel ports path writes straight to the
+// document, so it blends them itself before the write, see InvertPorts.
+// Interleaved tiles carry planes samples per pixel and one mask byte per
+// pixel, so a span of pixels is a run of span * planes samples. Partial
+// inversion draws a chunk of decisions at a time as bits, ands in the
+// selection packed the same way and inverts the runs of set bits. Decisions
+// are keyed by document position so a pixel gets the same answer whichever
+// tile or plane pass it falls in.
+//
+//-------------------------------------------------------------------------------
+template <typename Pixel> struct PixelTraits;
+
+template <> struct PixelTraits<uint8>
+{
+	static inline InvertRunProc Run(const InvertKernels& kernels) { return kernels.invert8; }
+};
+
+template <> struct PixelTraits<uint16>
+{
+	static inline InvertRunProc Run(const InvertKernels& kernels) { return kernels.invert16; }
+};
+
+template <> struct PixelTraits<float>
+{
+	static inline InvertRunProc Run(const InvertKernels& kernels) { return kernels.invert32; }
+};
+
+struct IgnoreMask
+{
+	enum { kUsesMask = false };
+};
+
+struct SelectionMask
+{
+	enum { kUsesMask = true };
+};
+
+const int32 kDecisionChunk = 4096;
+const int32 kDecisionWords = kDecisionChunk / kMaskWordBits;
+
+template <typename Pixel>
+static inline void InvertSpans(const InvertKernels& kernels,
+							   InvertRunProc invertRun,
+							   Pixel* pixel,
+							   const uint8* mask,
+							   int32 width,
+							   int32 planes)
+{
+	int32 x = 0;
+	while (x < width)
+	{
+		MaskSpanKind kind;
+		int32 end = NextMaskSpan(kernels, mask, x, width, kind);
+		if (kind != spanSkip)
+			invertRun(pixel + x * planes, (end - x) * planes);
+		x = end;
+	}
+}
+
+template <typename Pixel>
+static inline void InvertBitSpans(InvertRunProc invertRun,
+								  Pixel* pixel,
+								  const InvertMaskWord* bits,
+								  int32 width,
+								  int32 planes)
+{
+	int32 x = NextMaskBit(bits, 0, width, true);
+	while (x < width)
+	{
+		int32 end = NextMaskBit(bits, x, width, false);
+		invertRun(pixel + x * planes, (end - x) * planes);
+		x = NextMaskBit(bits, end, width, true);
+	}
+}
+
+template <typename Pixel, typename MaskPolicy>
+static void InvertTile(const InvertKernels& kernels,
+					   uint8* data,
+					   int32 dataRowBytes,
+					   const uint8* mask,
+					   int32 maskRowBytes,
+					   int32 width,
+					   int32 height,
+					   int32 planes,
+					   const InvertPick* pick)
+{
+	InvertRunProc invertRun = PixelTraits<Pixel>::Run(kernels);
+	InvertMaskWord picked[kDecisionWords];
+	InvertMaskWord selected[kDecisionWords];
+
+	for (int32 y = 0; y < height; y++)
+	{
+		Pixel* pixel = (Pixel*)data;
+
+		if (pick != NULL)
+		{
+			int32 pickY = pick->top + y * pick->step;
+			for (int32 x = 0; x < width; x += kDecisionChunk)
+			{
+				int32 count = width - x < kDecisionChunk ? width - x : kDecisionChunk;
+				kernels.decide(*pick, pick->left + x * pick->step, pickY, picked, count);
+				if (MaskPolicy::kUsesMask)
+				{
+					// partial mask values count as selected, the host blends them
+					kernels.packMask(mask + x, selected, count);
+					for (int32 w = 0; w < MaskWords(count); w++)
+						picked[w] &= selected[w];
+				}
+				InvertBitSpans(invertRun, pixel + x * planes, picked, count, planes);
+			}
+		}
+		else if (!MaskPolicy::kUsesMask)
+		{
+			invertRun(pixel, width * planes);
+		}
+		else
+		{
+			InvertSpans(kernels, invertRun, pixel, mask, width, planes);
+		}
+
+		if (MaskPolicy::kUsesMask)
+			mask += maskRowBytes;
+		data += dataRowBytes;
+	}
+}
+
+static const InvertTileProc kTileProcs[3][2] =
+{
+	{ InvertTile<uint8, IgnoreMask>, InvertTile<uint8, SelectionMask> },
+	{ InvertTile<uint16, IgnoreMask>, InvertTile<uint16, SelectionMask> },
+	{ InvertTile<float, IgnoreMask>, InvertTile<float, SelectionMask> }
+};
+
+//-------------------------------------------------------------------------------
+//
+// GetInvertTileProc
+//
+// Pick the specialization for a tile. Call this once per tile, not per row.
+//
+//-------------------------------------------------------------------------------
+InvertTileProc GetInvertTileProc(int32 depth, bool masked)
+{
+	int32 depthIndex = depth == 32 ? 2 : depth == 16 ? 1 : 0;
+	return kTileProcs[depthIndex][masked ? 1 : 0];
+}
+
+//-------------------------------------------------------------------------------
+//
+// VerifyInvertKernels
+//
+// Run each kernel of the table and the scalar kernel over the same data and
+// compare the results bit for bit. The data covers every 8 and 16 bit value,
+// the interesting floats (zero, denormals, out of range, infinities, NaNs) and
+// odd lengths and misaligned starts so the tail code gets exercised too. The
+// masked tile kernels are checked against the scalar kernel run pixel by pixel
+// wherever the mask is set, both planar and interleaved. The decide kernel
+// has to pick the same pixels as the scalar one deciding them one at a time,
+// and the mask packer has to match the mask byte for bit, both without
+// touching the word after their last. The partial tiles have to invert
+// exactly the pixels picked and selected. The 8 bit
+// conversions for the proxy are held to the scalar ones the same way.
+//
+//-------------------------------------------------------------------------------
+bool VerifyInvertKernels(const InvertKernels& kernels)
+{
+	const int32 kSamples = 65536 + 77;
+	const int32 kBytes = kSamples * 4 + 64;
+
+	uint8* pattern = new uint8[kBytes];
+	uint8* expected = new uint8[kBytes];
+	uint8* actual = new uint8[kBytes];
+	uint8* mask = new uint8[kSamples];
+
+	uint32 seed = 0x2545F491;
+	for (int32 b = 0; b < kBytes; b++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		pattern[b] = (uint8)(seed >> 24);
+	}
+
+	uint16* bigPixel = (uint16*)pattern;
+	for (int32 s = 0; s < 65536; s++)
+		bigPixel[s] = (uint16)s;
+
+	const uint32 specials[] = { 0x00000000, 0x80000000, 0x00000001, 0x807FFFFF,
+								0x3F800000, 0x3F800001, 0x3F7FFFFF, 0x40000000,
+								0xBF800000, 0x7F800000, 0xFF800000, 0x7FC00000,
+								0x7F800001, 0xFFFFFFFF, 0x33800000, 0x7F7FFFFF };
+	memcpy(pattern + kBytes / 2, specials, sizeof(specials));
+
+	for (int32 m = 0; m < kSamples; m++)
+		mask[m] = (m % 7) < 3 ? 0 : (uint8)(m * 31);
+
+	bool same = true;
+	for (int32 depth = 8; depth <= 32 && same; depth *= 2)
+	{
+		InvertRunProc candidate = GetInvertRunProc(kernels, depth);
+		InvertRunProc scalar = depth == 32 ? InvertRun32Scalar :
+							   depth == 16 ? InvertRun16Scalar :
+							   InvertRun8Scalar;
+		int32 sampleBytes = depth / 8;
+
+		for (int32 offset = 0; offset < 4 && same; offset++)
+		{
+			for (int32 length = 0; length < 200 && same; length += 13)
+			{
+				int32 count = length == 0 ? kSamples - 4 : length;
+				memcpy(expected, pattern, kBytes);
+				memcpy(actual, pattern, kBytes);
+				scalar(expected + offset * sampleBytes, count);
+				candidate(actual + offset * sampleBytes, count);
+				same = memcmp(actual, expected, kBytes) == 0;
+
+				int32 maxPlanes = length == 0 ? 1 : 4;
+				for (int32 planes = 1; planes <= maxPlanes && same; planes += 3)
+				{
+					InvertTileProc maskedTile = GetInvertTileProc(depth, true);
+					memcpy(expected, pattern, kBytes);
+					memcpy(actual, pattern, kBytes);
+					for (int32 m = 0; m < count; m++)
+						if (mask[m])
+							scalar(expected + (offset + m * planes) * sampleBytes, planes);
+					maskedTile(kernels, actual + offset * sampleBytes, 0, mask, 0, count, 1, planes, NULL);
+					same = memcmp(actual, expected, kBytes) == 0;
+				}
+			}
+		}
+	}
+
+	const uint32 thresholds[] = { 0, 1, 0x8000, 655, 64880, 0xFFFF };
+	const int32 kMaxCount = 300;
+	InvertMaskWord expectedBits[(kMaxCount + kMaskWordBits - 1) / kMaskWordBits + 1];
+	InvertMaskWord actualBits[(kMaxCount + kMaskWordBits - 1) / kMaskWordBits + 1];
+	for (int32 t = 0; t < 6 && same; t++)
+	{
+		for (int32 count = 0; count < kMaxCount && same; count += 7)
+		{
+			InvertPick pick;
+			pick.seed = 0x1234 + count;
+			pick.threshold = thresholds[t];
+			pick.left = count % 5;
+			pick.top = 1000 * t;
+			pick.step = count % 3 == 0 ? 3 : 1;
+
+			// the same pixel decided alone has to agree with it decided in a row
+			int32 x = pick.left + t * 0x10000;
+			int32 words = MaskWords(count);
+			memset(expectedBits, 0x5A, sizeof(expectedBits));
+			memset(actualBits, 0x5A, sizeof(actualBits));
+			memset(expectedBits, 0, words * sizeof(InvertMaskWord));
+			for (int32 d = 0; d < count; d++)
+			{
+				InvertMaskWord one;
+				InvertDecideScalar(pick, x + d * pick.step, pick.top, &one, 1);
+				expectedBits[d / kMaskWordBits] |= one << (d % kMaskWordBits);
+			}
+			kernels.decide(pick, x, pick.top, actualBits, count);
+			same = memcmp(actualBits, expectedBits, sizeof(expectedBits)) == 0;
+
+			for (int32 offset = 0; offset < 3 && same; offset++)
+			{
+				memset(expectedBits, 0x5A, sizeof(expectedBits));
+				memset(actualBits, 0x5A, sizeof(actualBits));
+				memset(expectedBits, 0, words * sizeof(InvertMaskWord));
+				for (int32 d = 0; d < count; d++)
+					if (mask[offset + d] != 0)
+						expectedBits[d / kMaskWordBits] |= (InvertMaskWord)1 << (d % kMaskWordBits);
+				kernels.packMask(mask + offset, actualBits, count);
+				same = memcmp(actualBits, expectedBits, sizeof(expectedBits)) == 0;
+			}
+
+			if (same)
+			{
+				InvertTileProc maskedTile = GetInvertTileProc(8, true);
+				InvertMaskWord* picked = expectedBits;
+				InvertDecideScalar(pick, pick.left, pick.top, picked, count);
+				memcpy(expected, pattern, count);
+				memcpy(actual, pattern, count);
+				for (int32 m = 0; m < count; m++)
+					if (mask[m] && ((picked[m / kMaskWordBits] >> (m % kMaskWordBits)) & 1))
+						InvertRun8Scalar(expected + m, 1);
+				maskedTile(kernels, actual, 0, mask, 0, count, 1, 1, &pick);
+				same = memcmp(actual, expected, count) == 0;
+			}
+		}
+	}
+
+	// the proxy conversions, rounded and dithered, over every 16 bit value and
+	// a float ramp from below 0 to above 1 with the specials in front
+	float* ramp = new float[kSamples];
+	for (int32 s = 0; s < kSamples; s++)
+		ramp[s] = (float)s / 60000.0f - 0.05f;
+	memcpy(ramp, specials, sizeof(specials));
+
+	for (int32 depth = 16; depth <= 32 && same; depth *= 2)
+	{
+		ConvertRowProc candidate = GetConvertRowProc(kernels, depth);
+		ConvertRowProc scalar = depth == 32 ? Convert32To8Scalar : Convert16To8Scalar;
+		const uint8* source = depth == 32 ? (const uint8*)ramp : pattern;
+		int32 sampleBytes = depth / 8;
+
+		for (int32 row = -1; row < 4 && same; row++)
+		{
+			const uint8* dither = row < 0 ? NULL : OrderedDitherRow(row);
+			for (int32 offset = 0; offset < 2 && same; offset++)
+			{
+				for (int32 length = 0; length < 200 && same; length += 13)
+				{
+					int32 count = length == 0 ? kSamples - 4 : length;
+					memset(expected, 0x5A, count + 16);
+					memset(actual, 0x5A, count + 16);
+					scalar(source + offset * sampleBytes, expected, count, dither);
+					candidate(source + offset * sampleBytes, actual, count, dither);
+					same = memcmp(actual, expected, count + 16) == 0;
+				}
+			}
+		}
+	}
+
+	delete [] ramp;
+	delete [] pattern;
+	delete [] expected;
+	delete [] actual;
+	delete [] mask;
+
+	return same;
+}
+
+//-------------------------------------------------------------------------------
+//
+// InvertISAName
+//
+// For the log file.
+//
+//-------------------------------------------------------------------------------
+const char* InvertISAName(InvertISA isa)
+{
+	switch (isa)
+	{
+		case isaAVX512:
+			return "AVX-512";
+		case isaAVX2:
+			return "AVX2";
+		case isaSSE2:
+			return "SSE2";
+		default:
+			break;
+	}
+	return "scalar";
+}
+
+// end InvertKernels.cpp
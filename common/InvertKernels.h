@@ -0,0 +1,122 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+#ifndef _INVERTKERNELS_H
+#define _INVERTKERNELS_H
+
+#include "PSIntTypes.h"
+
+// instruction sets we have kernels for, in increasing order of preference
+typedef enum InvertISA
+{
+	isaScalar = 0,
+	isaSSE2,
+	isaAVX2,
+	isaAVX512
+} InvertISA;
+
+// invert count contiguous samples in place
+typedef void (*InvertRunProc)(void* data, int32 count);
+
+// which pixels a partial inversion picks: tile pixel (x, y) is document pixel
+// (left + x * step, top + y * step) and is picked when its draw for seed is
+// below threshold
+typedef struct InvertPick
+{
+	uint32 seed;
+	uint32 threshold;
+	int32 left;
+	int32 top;
+	int32 step;
+} InvertPick;
+
+// one bit per pixel, pixel d of a row is bit d % 64 of word d / 64
+typedef uint64 InvertMaskWord;
+const int32 kMaskWordBits = 64;
+
+// words holding count pixels
+inline int32 MaskWords(int32 count)
+{
+	return (count + kMaskWordBits - 1) / kMaskWordBits;
+}
+
+// set the bits of the pixels picked and clear the rest, starting at document
+// pixel (x, y) and moving step pixels to the right each time. The bits past
+// count in the last word come out clear.
+typedef void (*InvertDecideProc)(const InvertPick& pick,
+								 int32 x,
+								 int32 y,
+								 InvertMaskWord* decisions,
+								 int32 count);
+
+// set the bit of every pixel with a mask value other than 0, clear the rest
+typedef void (*PackMaskProc)(const uint8* mask,
+							 InvertMaskWord* bits,
+							 int32 count);
+
+// bring count samples down to 8 bits, rounded to nearest or, with a non NULL
+// dither, ordered dithered with dither[x & 3] for sample x of the row
+typedef void (*ConvertRowProc)(const void* source,
+							   uint8* destination,
+							   int32 count,
+							   const uint8* dither);
+
+typedef struct InvertKernels
+{
+	InvertISA isa;
+	InvertRunProc invert8;
+	InvertRunProc invert16;
+	InvertRunProc invert32;
+	InvertDecideProc decide;
+	PackMaskProc packMask;
+	ConvertRowProc convert16;
+	ConvertRowProc convert32;
+} InvertKernels;
+
+// runs of mask values, 0, 255 and everything in between
+typedef enum MaskSpanKind
+{
+	spanSkip = 0,
+	spanFull,
+	spanPartial
+} MaskSpanKind;
+
+// invert a width by height block of pixels with planes interleaved samples each,
+// masked tiles leave pixels with a zero mask alone and a non NULL pick only
+// inverts the pixels it picks
+typedef void (*InvertTileProc)(const InvertKernels& kernels,
+							   uint8* data,
+							   int32 dataRowBytes,
+							   const uint8* mask,
+							   int32 maskRowBytes,
+							   int32 width,
+							   int32 height,
+							   int32 planes,
+							   const InvertPick* pick);
+
+extern InvertKernels gKernels;
+
+InvertISA DetectInvertISA(void);
+void SelectInvertKernels(InvertKernels& kernels, InvertISA isa);
+uint32 InvertThreshold(int16 percent);
+InvertRunProc GetInvertRunProc(const InvertKernels& kernels, int32 depth);
+InvertTileProc GetInvertTileProc(int32 depth, bool masked);
+ConvertRowProc GetConvertRowProc(const InvertKernels& kernels, int32 depth);
+const uint8* OrderedDitherRow(int32 y);
+int32 NextMaskSpan(const InvertKernels& kernels,
+				   const uint8* mask,
+				   int32 start,
+				   int32 width,
+				   MaskSpanKind& kind);
+bool VerifyInvertKernels(const InvertKernels& kernels);
+const char* InvertISAName(InvertISA isa);
+
+#endif
+// end InvertKernels.h
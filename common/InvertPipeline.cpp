@@ -0,0 +1,498 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertPipeline.h"
+#include "InvertBuffers.h"
+#include "InvertArena.h"
+#include "FilterBigDocument.h"
+#include "Logger.h"
+#include <string.h>
+
+//-------------------------------------------------------------------------------
+//
+// Pipeline
+//
+// The host only talks to the thread that called us, so that thread stays on
+// advanceState. Each call asks for the input of tile n and hands back the
+// output of tile n - 2, while the workers invert tile n - 1 in a plug-in owned
+// slot. Two slots are enough: the slot tile n - 2 is copied out of is the one
+// tile n is copied into.
+//
+// in:       0   1   2   3  ...
+// compute:      0   1   2  ...
+// out:              0   1  ...
+//
+//-------------------------------------------------------------------------------
+const int32 kMaxWorkers = 256;
+const int32 kStripsPerWorker = 4;
+const int32 kMinStripRows = 8;
+
+//-------------------------------------------------------------------------------
+//
+// InvertWorkers
+//
+// Every thread is launched before the first job and then sleeps until Start
+// bumps the generation.
+//
+//-------------------------------------------------------------------------------
+InvertWorkers::InvertWorkers() : generation(0), nextStrip(0), stripsLeft(0), quit(false), busy(0)
+{
+	memset(&job, 0, sizeof(job));
+}
+
+InvertWorkers::~InvertWorkers()
+{
+	Stop();
+}
+
+bool InvertWorkers::Launch(int32 count)
+{
+	try
+	{
+		for (int32 t = 0; t < count; t++)
+			threads.push_back(std::thread(Main, this));
+	}
+	catch (...)
+	{
+		Stop();
+		return false;
+	}
+	return true;
+}
+
+void InvertWorkers::Stop(void)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+	}
+	wake.notify_all();
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+	threads.clear();
+}
+
+void InvertWorkers::Start(const InvertJob& newJob)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		job = newJob;
+		nextStrip = 0;
+		stripsLeft = newJob.strips;
+		generation++;
+	}
+	wake.notify_all();
+}
+
+void InvertWorkers::Wait(void)
+{
+	std::unique_lock<std::mutex> guard(lock);
+	while (stripsLeft > 0)
+		done.wait(guard);
+}
+
+void InvertWorkers::Main(InvertWorkers* workers)
+{
+	workers->Work();
+}
+
+void InvertWorkers::Work(void)
+{
+	// every thread is launched before the first job, so none has been missed
+	std::unique_lock<std::mutex> guard(lock);
+	int32 seen = 0;
+
+	for (;;)
+	{
+		while (!quit && seen == generation)
+			wake.wait(guard);
+		if (quit)
+			return;
+		seen = generation;
+
+		while (nextStrip < job.strips)
+		{
+			int32 strip = nextStrip++;
+			InvertJob current = job;
+			guard.unlock();
+
+			PipelineClock::time_point start = PipelineClock::now();
+
+			int32 top = strip * current.stripRows;
+			int32 bottom = top + current.stripRows;
+			if (bottom > current.rect.bottom - current.rect.top)
+				bottom = current.rect.bottom - current.rect.top;
+
+			VRect stripRect = current.rect;
+			stripRect.top = current.rect.top + top;
+			stripRect.bottom = current.rect.top + bottom;
+
+			InvertRectangle(current.data + top * current.rowBytes,
+				current.rowBytes,
+				current.mask != NULL ? current.mask + top * current.maskRowBytes : NULL,
+				current.maskRowBytes,
+				stripRect,
+				current.depth,
+				current.planes,
+				1);
+
+			double elapsed = MillisecondsSince(start);
+
+			guard.lock();
+			busy += elapsed;
+			if (--stripsLeft == 0)
+				done.notify_all();
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------
+//
+// SplitInvertJob
+//
+// A few strips per worker so a slow thread doesn't hold up the tile, but not
+// so thin that the kernels spend their time starting rows.
+//
+//-------------------------------------------------------------------------------
+void SplitInvertJob(InvertJob& job, int32 workerCount)
+{
+	int32 height = job.rect.bottom - job.rect.top;
+	job.strips = workerCount * kStripsPerWorker;
+	if (job.strips > (height + kMinStripRows - 1) / kMinStripRows)
+		job.strips = (height + kMinStripRows - 1) / kMinStripRows;
+	job.stripRows = job.strips > 0 ? (height + job.strips - 1) / job.strips : 0;
+	if (job.stripRows > 0)
+		job.strips = (height + job.stripRows - 1) / job.stripRows;
+}
+
+//-------------------------------------------------------------------------------
+//
+// CopyTile
+//
+// Move a tile between host memory, in whatever column and plane layout the
+// host reports, and a slot where the planes are packed side by side. Hosts
+// that don't report a layout use the traditional interleaved one.
+//
+//-------------------------------------------------------------------------------
+static void CopyTile(uint8* host,
+					 int32 hostRowBytes,
+					 int32 hostColumnBytes,
+					 int32 hostPlaneBytes,
+					 uint8* slot,
+					 int32 slotRowBytes,
+					 int32 width,
+					 int32 height,
+					 bool toHost)
+{
+	int32 sampleBytes = gFilterRecord->depth / 8;
+	int32 planes = gFilterRecord->planes;
+	int32 pixelBytes = sampleBytes * planes;
+
+	if (hostColumnBytes == 0)
+		hostColumnBytes = pixelBytes;
+	if (hostPlaneBytes == 0)
+		hostPlaneBytes = sampleBytes;
+
+	for (int32 y = 0; y < height; y++)
+	{
+		uint8* hostRow = host + (size_t)y * hostRowBytes;
+		uint8* slotRow = slot + (size_t)y * slotRowBytes;
+
+		if (hostColumnBytes == pixelBytes && hostPlaneBytes == sampleBytes)
+		{
+			if (toHost)
+				memcpy(hostRow, slotRow, (size_t)width * pixelBytes);
+			else
+				memcpy(slotRow, hostRow, (size_t)width * pixelBytes);
+			continue;
+		}
+
+		for (int32 x = 0; x < width; x++)
+		{
+			for (int32 p = 0; p < planes; p++)
+			{
+				uint8* hostSample = hostRow + x * hostColumnBytes + p * hostPlaneBytes;
+				uint8* slotSample = slotRow + x * pixelBytes + p * sampleBytes;
+				if (toHost)
+					memcpy(hostSample, slotSample, sampleBytes);
+				else
+					memcpy(slotSample, hostSample, sampleBytes);
+			}
+		}
+	}
+}
+
+static void CopyMask(const uint8* mask, int32 maskRowBytes, uint8* slot, int32 slotRowBytes, int32 width, int32 height)
+{
+	for (int32 y = 0; y < height; y++)
+		memcpy(slot + (size_t)y * slotRowBytes, mask + (size_t)y * maskRowBytes, width);
+}
+
+//-------------------------------------------------------------------------------
+//
+// InvertWorkerCount
+//
+// One thread is busy with the host so it does not count. A single core
+// machine has nothing to overlap with.
+//
+//-------------------------------------------------------------------------------
+int32 InvertWorkerCount(void)
+{
+	int32 cores = (int32)std::thread::hardware_concurrency();
+	if (cores < 2)
+		return 0;
+	int32 workers = cores - 1;
+	if (workers > kMaxWorkers)
+		workers = kMaxWorkers;
+	return workers;
+}
+
+//-------------------------------------------------------------------------------
+//
+// AllocateSlots
+//
+// Both slots or neither, pixelBytes of pixels and maskBytes of mask each.
+// The arena is tried first, the mask starts on a fresh line so the kernels
+// see it aligned too.
+//
+//-------------------------------------------------------------------------------
+bool AllocateSlots(PipelineSlot slots[2], int64 pixelBytes, int64 maskBytes)
+{
+	memset(slots, 0, 2 * sizeof(PipelineSlot));
+
+	int64 mark = ArenaMark();
+	int64 alignedPixels = (pixelBytes + kArenaAlignment - 1) & ~(int64)(kArenaAlignment - 1);
+	for (int32 s = 0; s < 2; s++)
+	{
+		slots[s].pixels = (uint8*)ArenaAllocate(alignedPixels + maskBytes);
+		if (slots[s].pixels == NULL)
+			break;
+		slots[s].arenaMark = mark;
+		slots[s].mask = slots[s].pixels + alignedPixels;
+	}
+	if (slots[1].pixels != NULL)
+		return true;
+
+	ArenaRewind(mark);
+	memset(slots, 0, 2 * sizeof(PipelineSlot));
+	for (int32 s = 0; s < 2; s++)
+	{
+		slots[s].arenaMark = -1;
+		slots[s].pixels = (uint8*)ReserveBuffer(slots[s].bufferID, slots[s].capacity, pixelBytes + maskBytes);
+		if (slots[s].pixels == NULL)
+		{
+			FreeSlots(slots);
+			return false;
+		}
+		slots[s].mask = slots[s].pixels + pixelBytes;
+	}
+	return true;
+}
+
+void FreeSlots(PipelineSlot slots[2])
+{
+	if (slots[0].arenaMark >= 0)
+		ArenaRewind(slots[0].arenaMark);
+	for (int32 s = 0; s < 2; s++)
+	{
+		ReleaseBuffer(slots[s].bufferID, slots[s].capacity);
+		slots[s].arenaMark = -1;
+		slots[s].pixels = NULL;
+		slots[s].mask = NULL;
+	}
+}
+
+static void LogPipeline(int32 workers, int32 tiles, double advance, double copyIn,
+						double copyOut, double wait, double busy, double total)
+{
+	Logger logIt("Invert");
+	logIt.Write("Pipeline workers ", false);
+	logIt.Write(workers, false);
+	logIt.Write(" tiles ", false);
+	logIt.Write(tiles, false);
+	logIt.Write(" ms: advanceState ", false);
+	logIt.Write(advance, false);
+	logIt.Write(" copy in ", false);
+	logIt.Write(copyIn, false);
+	logIt.Write(" copy out ", false);
+	logIt.Write(copyOut, false);
+	logIt.Write(" waiting on workers ", false);
+	logIt.Write(wait, false);
+	logIt.Write(" worker busy ", false);
+	logIt.Write(busy, false);
+	logIt.Write(" total ", false);
+	logIt.Write(total, true);
+}
+
+//-------------------------------------------------------------------------------
+//
+// RunInvertPipeline
+//
+// The stage times go to the log: a long wait on the workers means we are
+// compute bound, a long advanceState with little waiting means the host is.
+// When the governor wants a new plan no more tiles are asked for and the two
+// in flight are written back before returning.
+//
+//-------------------------------------------------------------------------------
+bool RunInvertPipeline(const TilePlan& plan, Governor& governor, int32& stoppedAt)
+{
+	int32 tileWidth = plan.tileWidth;
+	int32 tileHeight = plan.tileHeight;
+
+	// tiles with nothing selected never reach the host
+	std::vector<int32> active;
+	for (int32 tile = 0; tile < TileCount(plan); tile++)
+		if (GetTileCoverage(plan, tile) != coverageEmpty)
+			active.push_back(tile);
+	int32 tiles = (int32)active.size();
+
+	int32 workerCount = InvertWorkerCount();
+	if (workerCount == 0 || tiles < 2)
+		return false;
+
+	int32 pixelBytes = gFilterRecord->depth / 8 * gFilterRecord->planes;
+	int64 pixelSize, maskSize, rowSize;
+	if (!BufferBytes(tileWidth, 1, pixelBytes, rowSize) || rowSize > INT32_MAX ||
+		!BufferBytes(tileWidth, tileHeight, pixelBytes, pixelSize) ||
+		!BufferBytes(tileWidth, tileHeight, 1, maskSize))
+		return false;
+	int32 slotRowBytes = (int32)rowSize;
+
+	PipelineSlot slots[2];
+	if (!AllocateSlots(slots, pixelSize, maskSize))
+		return false;
+	AutoSlots heldSlots(slots);
+
+	stoppedAt = TileCount(plan);
+
+	InvertWorkers workers;
+	if (!workers.Launch(workerCount))
+		return false;
+
+	PipelineClock::time_point started = PipelineClock::now();
+	double advanceTime = 0, copyInTime = 0, copyOutTime = 0, waitTime = 0;
+	VRect noRect = { 0, 0, 0, 0 };
+
+	gFilterRecord->outLoPlane = gFilterRecord->inLoPlane = 0;
+	gFilterRecord->outHiPlane = gFilterRecord->inHiPlane = gFilterRecord->planes - 1;
+
+	for (int32 step = 0; step < tiles + 2; step++)
+	{
+		PipelineSlot& inSlot = slots[step % 2];
+		PipelineSlot& outSlot = slots[step % 2];
+
+		if (step < tiles && GovernorWantsReplan(governor, plan, active[step]))
+		{
+			stoppedAt = active[step];
+			tiles = step;
+		}
+
+		VRect inRect = noRect;
+		bool needMask = false;
+		if (step < tiles)
+		{
+			inRect = GetTileRect(plan, active[step]);
+			needMask = GetTileCoverage(plan, active[step]) != coverageFull;
+		}
+		SetInRect(inRect);
+		if (gFilterRecord->haveMask)
+			SetMaskRect(needMask ? inRect : noRect);
+		SetOutRect(step >= 2 ? outSlot.rect : noRect);
+
+		PipelineClock::time_point start = PipelineClock::now();
+		*gResult = gFilterRecord->advanceState();
+		advanceTime += MillisecondsSince(start);
+
+		if (*gResult != noErr)
+			break;
+
+		if (step >= 2)
+		{
+			start = PipelineClock::now();
+			CopyTile((uint8*)gFilterRecord->outData,
+				gFilterRecord->outRowBytes,
+				gFilterRecord->outColumnBytes,
+				gFilterRecord->outPlaneBytes,
+				outSlot.pixels,
+				slotRowBytes,
+				outSlot.rect.right - outSlot.rect.left,
+				outSlot.rect.bottom - outSlot.rect.top,
+				true);
+			copyOutTime += MillisecondsSince(start);
+
+			GovernorProgress(governor, plan, active[step - 2]);
+		}
+
+		bool maskCopied = false;
+		if (step < tiles)
+		{
+			start = PipelineClock::now();
+			inSlot.rect = inRect;
+			int32 width = inRect.right - inRect.left;
+			int32 height = inRect.bottom - inRect.top;
+			CopyTile((uint8*)gFilterRecord->inData,
+				gFilterRecord->inRowBytes,
+				gFilterRecord->inColumnBytes,
+				gFilterRecord->inPlaneBytes,
+				inSlot.pixels,
+				slotRowBytes,
+				width,
+				height,
+				false);
+			if (needMask && gFilterRecord->maskData != NULL)
+			{
+				CopyMask((const uint8*)gFilterRecord->maskData,
+					gFilterRecord->maskRowBytes,
+					inSlot.mask,
+					tileWidth,
+					width,
+					height);
+				maskCopied = true;
+			}
+			copyInTime += MillisecondsSince(start);
+		}
+
+		start = PipelineClock::now();
+		workers.Wait();
+		waitTime += MillisecondsSince(start);
+
+		if (step < tiles)
+		{
+			InvertJob job;
+			job.data = inSlot.pixels;
+			job.rowBytes = slotRowBytes;
+			job.mask = maskCopied ? inSlot.mask : NULL;
+			job.maskRowBytes = tileWidth;
+			job.rect = inSlot.rect;
+			job.depth = gFilterRecord->depth;
+			job.planes = gFilterRecord->planes;
+
+			SplitInvertJob(job, workerCount);
+
+			workers.Start(job);
+		}
+
+		if (gFilterRecord->abortProc())
+		{
+			*gResult = userCanceledErr;
+			break;
+		}
+	}
+
+	workers.Wait();
+
+	LogPipeline(workers.Count(), tiles, advanceTime, copyInTime, copyOutTime,
+				waitTime, workers.BusyMilliseconds(), MillisecondsSince(started));
+
+	return true;
+}
+
+// end InvertPipeline.cpp
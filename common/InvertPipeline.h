@@ -0,0 +1,120 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+#ifndef _INVERTPIPELINE_H
+#define _INVERTPIPELINE_H
+
+#include "Invert.h"
+#include "InvertTiles.h"
+#include "InvertGovernor.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock PipelineClock;
+
+inline double MillisecondsSince(PipelineClock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(PipelineClock::now() - start).count();
+}
+
+// one tile for the workers, cut into strips of whole rows
+typedef struct InvertJob
+{
+	uint8* data;
+	int32 rowBytes;
+	uint8* mask;
+	int32 maskRowBytes;
+	VRect rect;
+	int32 depth;
+	int32 planes;
+	int32 strips;
+	int32 stripRows;
+} InvertJob;
+
+// a plug-in owned copy of one tile, pixels interleaved and then the mask
+typedef struct PipelineSlot
+{
+	BufferID bufferID;
+	int64 capacity;
+	int64 arenaMark;		// where the slots start in the arena, -1 if bufferID holds them
+	uint8* pixels;
+	uint8* mask;
+	VRect rect;
+} PipelineSlot;
+
+// A fixed set of threads that take strips of the current job until it is
+// done. Start returns at once, Wait blocks until every strip is inverted.
+class InvertWorkers
+{
+public:
+	InvertWorkers();
+	~InvertWorkers();
+
+	bool Launch(int32 count);
+	void Start(const InvertJob& newJob);
+	void Wait(void);
+
+	int32 Count(void) const { return (int32)threads.size(); }
+	double BusyMilliseconds(void) const { return busy; }
+
+private:
+	static void Main(InvertWorkers* workers);
+	void Work(void);
+	void Stop(void);
+
+	std::vector<std::thread> threads;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	InvertJob job;
+	int32 generation;
+	int32 nextStrip;
+	int32 stripsLeft;
+	bool quit;
+	double busy;
+};
+
+// Run the filter loop with worker threads inverting one tile while the host
+// fetches the next. Returns false, before any advanceState, when the pipeline
+// can't be used and the serial loop should run instead. stoppedAt is the
+// tile the governor wanted a new plan from, TileCount when all were done.
+bool RunInvertPipeline(const TilePlan& plan, Governor& governor, int32& stoppedAt);
+
+// worker threads the pipeline would start, 0 when it won't run
+int32 InvertWorkerCount(void);
+
+// cut job into strips for workerCount threads
+void SplitInvertJob(InvertJob& job, int32 workerCount);
+
+// two tile slots from the session arena or else plug-in buffers, FreeSlots
+// takes both back
+bool AllocateSlots(PipelineSlot slots[2], int64 pixelBytes, int64 maskBytes);
+void FreeSlots(PipelineSlot slots[2]);
+
+// FreeSlots however the scope is left. Made once AllocateSlots has succeeded
+// and before the workers, so they are stopped before their slots go.
+class AutoSlots
+{
+public:
+	explicit AutoSlots(PipelineSlot* held) : slots(held) { }
+	~AutoSlots() { FreeSlots(slots); }
+
+private:
+	PipelineSlot* slots;
+
+	AutoSlots(const AutoSlots&);
+	AutoSlots& operator=(const AutoSlots&);
+};
+
+#endif
+// end InvertPipeline.h
@@ -0,0 +1,483 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertPorts.h"
+#include "InvertPipeline.h"
+#include "InvertTiles.h"
+#include "InvertBuffers.h"
+#include "FilterBigDocument.h"
+#include "PIChannelPortsSuite.h"
+#include "Logger.h"
+#include <string.h>
+
+//-------------------------------------------------------------------------------
+//
+// Channel ports
+//
+// When the host hands us read and write ports for the target channels we can
+// skip advanceState altogether and move pixels a host tile at a time, on the
+// host's own tiling grid, straight between its tiles and a slot of ours. The
+// ports read one channel each, so every channel is read into its place in an
+// interleaved slot and the kernels see the same layout as everywhere else.
+//
+// As in the pipeline, only the calling thread talks to the host. It reads
+// tile n while the workers invert tile n - 1, then writes tile n - 1 back
+// while the workers start on tile n.
+//
+// read:     0   1   2   3  ...
+// compute:      0   1   2  ...
+// write:        0   1   2  ...
+//
+// Writing to a port bypasses the blend the host does after advanceState, so
+// a feathered selection is blended here. A tile with partly selected pixels
+// is kept as it was read, and once the workers are done each of those pixels
+// becomes original + (inverted - original) * mask / 255.
+//
+//-------------------------------------------------------------------------------
+
+// the channels we read and write, in the filter's plane order
+typedef struct PortChannels
+{
+	PSChannelPortsSuite1* suite;
+	std::vector<ReadChannelDesc*> planes;
+	ReadChannelDesc* selection;
+	VPoint tileOrigin;
+	VPoint tileSize;
+} PortChannels;
+
+static bool ContainsRect(const VRect& outer, const VRect& inner)
+{
+	return inner.left >= outer.left && inner.top >= outer.top &&
+		   inner.right <= outer.right && inner.bottom <= outer.bottom;
+}
+
+static bool SameRect(const VRect& a, const VRect& b)
+{
+	return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+}
+
+//-------------------------------------------------------------------------------
+//
+// FindPortChannels
+//
+// The target layer's composite channels, with its transparency last when the
+// filter is given one more plane than there are colour channels. Every one
+// has to be writable, at the filter's depth and cover the filter rectangle.
+// The selection comes from the document's selection channel, we can't use
+// ports when there is a mask the host doesn't describe.
+//
+//-------------------------------------------------------------------------------
+static bool FindPortChannels(PortChannels& ports)
+{
+	ReadImageDocumentDesc* document = gFilterRecord->documentInfo;
+	if (document == NULL)
+		return false;
+
+	for (ReadChannelDesc* channel = document->targetCompositeChannels; channel != NULL; channel = channel->next)
+		ports.planes.push_back(channel);
+	if ((int32)ports.planes.size() + 1 == gFilterRecord->planes && document->targetTransparency != NULL)
+		ports.planes.push_back(document->targetTransparency);
+	if (ports.planes.empty() || (int32)ports.planes.size() != gFilterRecord->planes)
+		return false;
+
+	VRect filterRect = GetFilterRect();
+
+	for (size_t p = 0; p < ports.planes.size(); p++)
+	{
+		ReadChannelDesc* channel = ports.planes[p];
+		if (channel->port == NULL || channel->depth != gFilterRecord->depth)
+			return false;
+		if (channel->maxVersion < 1 || channel->writePort == NULL)
+			return false;
+		if (!ContainsRect(channel->bounds, filterRect))
+			return false;
+
+		Boolean canWrite = false;
+		if (ports.suite->CanWrite(channel->writePort, &canWrite) != noErr || !canWrite)
+			return false;
+	}
+
+	ports.selection = NULL;
+	if (gFilterRecord->haveMask && !gParams->ignoreSelection)
+	{
+		if (document->selection == NULL || document->selection->port == NULL || document->selection->depth != 8)
+			return false;
+		ports.selection = document->selection;
+	}
+
+	ReadChannelDesc* first = ports.planes[0];
+	if (ports.suite->GetTilingGrid(first->port, 0, &ports.tileOrigin, &ports.tileSize) != noErr ||
+		ports.tileSize.h <= 0 || ports.tileSize.v <= 0)
+	{
+		ports.tileOrigin = first->tileOrigin;
+		ports.tileSize = first->tileSize;
+	}
+
+	return ports.tileSize.h > 0 && ports.tileSize.v > 0;
+}
+
+static void DescribeSlot(PixelMemoryDesc& memory, uint8* data, int32 rowBytes, int32 columnBytes, int32 depth)
+{
+	memory.data = data;
+	memory.rowBits = rowBytes * 8;
+	memory.colBits = columnBytes * 8;
+	memory.bitOffset = 0;
+	memory.depth = depth;
+}
+
+//-------------------------------------------------------------------------------
+//
+// ReadTile
+//
+// Every channel of slot.rect into its place in the slot, then the selection.
+// Outside the selection channel's bounds nothing is selected.
+//
+//-------------------------------------------------------------------------------
+static OSErr ReadTile(const PortChannels& ports, PipelineSlot& slot, int32 slotRowBytes, int32 maskRowBytes)
+{
+	int32 sampleBytes = gFilterRecord->depth / 8;
+	int32 pixelBytes = sampleBytes * gFilterRecord->planes;
+
+	for (size_t p = 0; p < ports.planes.size(); p++)
+	{
+		PixelMemoryDesc memory;
+		DescribeSlot(memory, slot.pixels + p * sampleBytes, slotRowBytes, pixelBytes, gFilterRecord->depth);
+
+		VRect bounds = slot.rect;
+		OSErr err = (OSErr)ports.suite->ReadPixelsFromLevel(ports.planes[p]->port, 0, &bounds, &memory);
+		if (err != noErr)
+			return err;
+		if (!SameRect(bounds, slot.rect))
+			return filterBadParameters;
+	}
+
+	if (ports.selection == NULL)
+		return noErr;
+
+	int32 width = slot.rect.right - slot.rect.left;
+	int32 height = slot.rect.bottom - slot.rect.top;
+	for (int32 y = 0; y < height; y++)
+		memset(slot.mask + (size_t)y * maskRowBytes, 0, width);
+
+	VRect bounds = slot.rect;
+	const VRect& selected = ports.selection->bounds;
+	if (bounds.left < selected.left)
+		bounds.left = selected.left;
+	if (bounds.top < selected.top)
+		bounds.top = selected.top;
+	if (bounds.right > selected.right)
+		bounds.right = selected.right;
+	if (bounds.bottom > selected.bottom)
+		bounds.bottom = selected.bottom;
+	if (bounds.right <= bounds.left || bounds.bottom <= bounds.top)
+		return noErr;
+
+	PixelMemoryDesc memory;
+	DescribeSlot(memory,
+				 slot.mask + (size_t)(bounds.top - slot.rect.top) * maskRowBytes + (bounds.left - slot.rect.left),
+				 maskRowBytes,
+				 1,
+				 8);
+
+	return (OSErr)ports.suite->ReadPixelsFromLevel(ports.selection->port, 0, &bounds, &memory);
+}
+
+// Copy the tile as read to original when any of its mask is neither 0 nor 255.
+static bool KeepPartlySelected(const PipelineSlot& slot, uint8* original, int32 slotRowBytes, int32 maskRowBytes)
+{
+	int32 width = slot.rect.right - slot.rect.left;
+	int32 height = slot.rect.bottom - slot.rect.top;
+
+	bool partial = false;
+	for (int32 y = 0; y < height && !partial; y++)
+	{
+		const uint8* mask = slot.mask + (size_t)y * maskRowBytes;
+		for (int32 x = 0; x < width; x++)
+		{
+			if (mask[x] != 0 && mask[x] != 255)
+			{
+				partial = true;
+				break;
+			}
+		}
+	}
+
+	if (partial)
+		memcpy(original, slot.pixels, (size_t)slotRowBytes * height);
+	return partial;
+}
+
+template <typename T>
+static inline void BlendSample(uint8* sample, const uint8* before, uint8 mask)
+{
+	T inverted, was;
+	memcpy(&inverted, sample, sizeof(T));
+	memcpy(&was, before, sizeof(T));
+	int32 difference = (int32)inverted - (int32)was;
+	int32 rounding = difference < 0 ? -127 : 127;
+	T blended = (T)(was + (difference * mask + rounding) / 255);
+	memcpy(sample, &blended, sizeof(T));
+}
+
+template <>
+inline void BlendSample<float>(uint8* sample, const uint8* before, uint8 mask)
+{
+	float inverted, was;
+	memcpy(&inverted, sample, sizeof(float));
+	memcpy(&was, before, sizeof(float));
+	float blended = was + (inverted - was) * (mask / 255.0f);
+	memcpy(sample, &blended, sizeof(float));
+}
+
+// what the host would have made of the inverted tile under a partial mask
+template <typename T>
+static void BlendPartlySelected(const PipelineSlot& slot, const uint8* original, int32 slotRowBytes, int32 maskRowBytes)
+{
+	int32 width = slot.rect.right - slot.rect.left;
+	int32 height = slot.rect.bottom - slot.rect.top;
+	int32 planes = gFilterRecord->planes;
+
+	for (int32 y = 0; y < height; y++)
+	{
+		const uint8* mask = slot.mask + (size_t)y * maskRowBytes;
+		uint8* row = slot.pixels + (size_t)y * slotRowBytes;
+		const uint8* before = original + (size_t)y * slotRowBytes;
+		for (int32 x = 0; x < width; x++)
+		{
+			if (mask[x] == 0 || mask[x] == 255)
+				continue;
+			size_t pixel = (size_t)x * planes * sizeof(T);
+			for (int32 p = 0; p < planes; p++)
+				BlendSample<T>(row + pixel + p * sizeof(T), before + pixel + p * sizeof(T), mask[x]);
+		}
+	}
+}
+
+static void BlendTile(const PipelineSlot& slot, const uint8* original, int32 slotRowBytes, int32 maskRowBytes)
+{
+	switch (gFilterRecord->depth)
+	{
+	case 8:
+		BlendPartlySelected<uint8>(slot, original, slotRowBytes, maskRowBytes);
+		break;
+	case 16:
+		BlendPartlySelected<uint16>(slot, original, slotRowBytes, maskRowBytes);
+		break;
+	case 32:
+		BlendPartlySelected<float>(slot, original, slotRowBytes, maskRowBytes);
+		break;
+	}
+}
+
+static OSErr WriteTile(const PortChannels& ports, const PipelineSlot& slot, int32 slotRowBytes)
+{
+	int32 sampleBytes = gFilterRecord->depth / 8;
+	int32 pixelBytes = sampleBytes * gFilterRecord->planes;
+
+	for (size_t p = 0; p < ports.planes.size(); p++)
+	{
+		PixelMemoryDesc memory;
+		DescribeSlot(memory, slot.pixels + p * sampleBytes, slotRowBytes, pixelBytes, gFilterRecord->depth);
+
+		VRect bounds = slot.rect;
+		OSErr err = (OSErr)ports.suite->WritePixelsToBaseLevel(ports.planes[p]->writePort, &bounds, &memory);
+		if (err != noErr)
+			return err;
+	}
+	return noErr;
+}
+
+// the stage times of one run, release builds don't open the log every filter run
+static void LogChannelPorts(int32 workers, int32 tiles, double read, double write, double wait, double total)
+{
+#ifdef _DEBUG
+	Logger logIt("Invert");
+	logIt.Write("Channel ports workers ", false);
+	logIt.Write(workers, false);
+	logIt.Write(" tiles ", false);
+	logIt.Write(tiles, false);
+	logIt.Write(" ms: read ", false);
+	logIt.Write(read, false);
+	logIt.Write(" write ", false);
+	logIt.Write(write, false);
+	logIt.Write(" waiting on workers ", false);
+	logIt.Write(wait, false);
+	logIt.Write(" total ", false);
+	logIt.Write(total, true);
+#endif
+}
+
+//-------------------------------------------------------------------------------
+//
+// RunInvertChannelPorts
+//
+// Without spare cores the tiles are inverted on this thread between the read
+// and the write, the host still only sees its own tiles.
+//
+//-------------------------------------------------------------------------------
+bool RunInvertChannelPorts(void)
+{
+	if (!HostChannelPortAvailable(gFilterRecord->channelPortProcs, NULL))
+		return false;
+	if (sSPBasic == NULL)
+		return false;
+
+	VRect zeroRect = { 0, 0, 0, 0 };
+
+	// nothing to invert, leave every tile as it is
+	if (gParams->percent <= 0)
+	{
+		SetInRect(zeroRect);
+		SetOutRect(zeroRect);
+		SetMaskRect(zeroRect);
+		return true;
+	}
+
+	PortChannels ports;
+	ports.suite = NULL;
+	if (sSPBasic->AcquireSuite(kPSChannelPortsSuite,
+							   kPSChannelPortsSuiteVersion2,
+							   (const void**)&ports.suite) != noErr ||
+		ports.suite == NULL)
+		return false;
+
+	TilePlan plan;
+	PipelineSlot slots[2];
+	int32 pixelBytes = gFilterRecord->depth / 8 * gFilterRecord->planes;
+	int32 slotRowBytes = 0;
+	int32 maskRowBytes = 0;
+	int64 slotBytes = 0;
+	uint8* originals[2] = { NULL, NULL };
+	bool blend[2] = { false, false };
+
+	bool usable = FindPortChannels(ports);
+	if (usable)
+	{
+		PlanGridTiles(plan, ports.tileOrigin, ports.tileSize);
+		maskRowBytes = ports.selection != NULL ? plan.tileWidth : 0;
+
+		// the port suite describes a row in bits, with a selection each
+		// slot keeps a second copy of its pixels for the blend
+		int64 rowSize, pixelSize, maskSize;
+		int32 copies = ports.selection != NULL ? 2 : 1;
+		usable = TileCount(plan) > 0 &&
+				 BufferBytes(plan.tileWidth, 1, pixelBytes * 8, rowSize) && rowSize <= INT32_MAX &&
+				 BufferBytes(plan.tileWidth, plan.tileHeight, pixelBytes, pixelSize) &&
+				 BufferBytes(pixelSize, copies, 1, slotBytes) &&
+				 BufferBytes(maskRowBytes, plan.tileHeight, 1, maskSize);
+		slotRowBytes = usable ? plan.tileWidth * pixelBytes : 0;
+		usable = usable && AllocateSlots(slots, slotBytes, maskSize);
+		if (usable && copies == 2)
+			for (int32 s = 0; s < 2; s++)
+				originals[s] = slots[s].pixels + pixelSize;
+	}
+	if (!usable)
+	{
+		sSPBasic->ReleaseSuite(kPSChannelPortsSuite, kPSChannelPortsSuiteVersion2);
+		return false;
+	}
+	AutoSlots heldSlots(slots);
+
+	int32 workerCount = InvertWorkerCount();
+	InvertWorkers workers;
+	if (workerCount > 0 && !workers.Launch(workerCount))
+		workerCount = 0;
+
+	int32 tiles = TileCount(plan);
+	PipelineClock::time_point started = PipelineClock::now();
+	double readTime = 0, writeTime = 0, waitTime = 0;
+
+	for (int32 step = 0; step <= tiles; step++)
+	{
+		PipelineSlot& readSlot = slots[step % 2];
+		PipelineSlot& writeSlot = slots[(step + 1) % 2];
+
+		OSErr err = noErr;
+		if (step < tiles)
+		{
+			PipelineClock::time_point start = PipelineClock::now();
+			readSlot.rect = GetTileRect(plan, step);
+			err = ReadTile(ports, readSlot, slotRowBytes, maskRowBytes);
+			blend[step % 2] = err == noErr && originals[step % 2] != NULL &&
+							  KeepPartlySelected(readSlot, originals[step % 2], slotRowBytes, maskRowBytes);
+			readTime += MillisecondsSince(start);
+		}
+
+		PipelineClock::time_point start = PipelineClock::now();
+		workers.Wait();
+		waitTime += MillisecondsSince(start);
+
+		if (err != noErr)
+		{
+			*gResult = err;
+			break;
+		}
+
+		if (step < tiles)
+		{
+			InvertJob job;
+			job.data = readSlot.pixels;
+			job.rowBytes = slotRowBytes;
+			job.mask = ports.selection != NULL ? readSlot.mask : NULL;
+			job.maskRowBytes = maskRowBytes;
+			job.rect = readSlot.rect;
+			job.depth = gFilterRecord->depth;
+			job.planes = gFilterRecord->planes;
+
+			if (workerCount > 0)
+			{
+				SplitInvertJob(job, workerCount);
+				workers.Start(job);
+			}
+			else
+			{
+				InvertRectangle(job.data, job.rowBytes, job.mask, job.maskRowBytes,
+								job.rect, job.depth, job.planes, 1);
+			}
+		}
+
+		if (step > 0)
+		{
+			start = PipelineClock::now();
+			if (blend[(step + 1) % 2])
+				BlendTile(writeSlot, originals[(step + 1) % 2], slotRowBytes, maskRowBytes);
+			err = WriteTile(ports, writeSlot, slotRowBytes);
+			writeTime += MillisecondsSince(start);
+			if (err != noErr)
+			{
+				*gResult = err;
+				break;
+			}
+
+			gFilterRecord->progressProc(step, tiles);
+		}
+
+		if (gFilterRecord->abortProc())
+		{
+			*gResult = userCanceledErr;
+			break;
+		}
+	}
+
+	workers.Wait();
+	sSPBasic->ReleaseSuite(kPSChannelPortsSuite, kPSChannelPortsSuiteVersion2);
+
+	// nothing left for advanceState to move
+	SetInRect(zeroRect);
+	SetOutRect(zeroRect);
+	SetMaskRect(zeroRect);
+
+	LogChannelPorts(workers.Count(), tiles, readTime, writeTime, waitTime, MillisecondsSince(started));
+
+	return true;
+}
+
+// end InvertPorts.cpp
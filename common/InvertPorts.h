@@ -0,0 +1,22 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+#ifndef _INVERTPORTS_H
+#define _INVERTPORTS_H
+
+#include "Invert.h"
+
+// Run the whole filter through the host's channel ports, one host tile at a
+// time. Returns false, before anything is read, when the host doesn't give us
+// ports we can read and write and advanceState should be used instead.
+bool RunInvertChannelPorts(void);
+
+#endif
+// end InvertPorts.h
@@ -0,0 +1,346 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertPreview.h"
+#include "InvertPipeline.h"
+#include "InvertTiming.h"
+#include <atomic>
+#include <string.h>
+
+//-------------------------------------------------------------------------------
+//
+// Preview renderer
+//
+// Once ReadProxySource has the source in memory a frame needs nothing from
+// the host, so it is drawn on a thread of its own and typing in the amount
+// field never waits for it. Every request bumps the generation. The renderer
+// looks at it between strips and drops a frame nobody wants any more, and a
+// finished frame is held until the dialog takes it, so a half drawn frame is
+// never shown.
+//
+// A request that comes within kPreviewDebounce of the one before is part of
+// a burst, a held down key say, and the renderer waits for the burst to go
+// quiet instead of starting frames it would throw away.
+//
+//-------------------------------------------------------------------------------
+const int32 kPreviewStripRows = 16;
+const std::chrono::milliseconds kPreviewDebounce(30);
+
+// what a frame is drawn from, copied out of gData by the dialog's thread
+typedef struct PreviewSource
+{
+	const uint8* pixels;
+	const uint8* mask;
+	int32 width;
+	int32 height;
+	int32 planeSize;
+	int32 planes;
+	int32 step;
+	VRect sampleRect;
+} PreviewSource;
+
+class PreviewRenderer
+{
+public:
+	PreviewRenderer();
+	~PreviewRenderer();
+
+	bool Request(const PreviewSource& newSource,
+				 const Parameters& newParams,
+				 PreviewReadyProc newReady,
+				 void* newContext);
+	bool Take(uint8* destination, const PreviewSource& current, double& latency, int32& dropped);
+	void Stop(void);
+
+private:
+	static void Main(PreviewRenderer* renderer);
+	void Run(void);
+	bool Render(const PreviewSource& from, const Parameters& with, uint32 target);
+
+	std::thread thread;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::atomic<uint32> generation;
+	uint32 rendered;
+	bool quit;
+	bool burst;
+	PipelineClock::time_point requestedAt;
+	PreviewSource source;
+	Parameters params;
+	PreviewReadyProc ready;
+	void* context;
+
+	// back belongs to the renderer, front to whoever holds the lock
+	std::vector<uint8> back;
+	std::vector<uint8> front;
+	PreviewSource frameSource;
+	bool frameReady;
+	double frameLatency;
+	int32 dropped;
+};
+
+static PreviewRenderer gPreviewRenderer;
+
+PreviewRenderer::PreviewRenderer()
+	: generation(0), rendered(0), quit(false), burst(false),
+	  ready(NULL), context(NULL), frameReady(false), frameLatency(0), dropped(0)
+{
+	memset(&source, 0, sizeof(source));
+	memset(&params, 0, sizeof(params));
+	memset(&frameSource, 0, sizeof(frameSource));
+}
+
+PreviewRenderer::~PreviewRenderer()
+{
+	Stop();
+}
+
+bool PreviewRenderer::Request(const PreviewSource& newSource,
+							  const Parameters& newParams,
+							  PreviewReadyProc newReady,
+							  void* newContext)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (!thread.joinable())
+		{
+			quit = false;
+			rendered = generation;
+			try
+			{
+				thread = std::thread(Main, this);
+			}
+			catch (...)
+			{
+				return false;
+			}
+		}
+
+		PipelineClock::time_point now = PipelineClock::now();
+		burst = rendered != generation || now - requestedAt < kPreviewDebounce;
+		requestedAt = now;
+		source = newSource;
+		params = newParams;
+		ready = newReady;
+		context = newContext;
+		generation++;
+	}
+	wake.notify_all();
+	return true;
+}
+
+bool PreviewRenderer::Take(uint8* destination, const PreviewSource& current, double& latency, int32& droppedFrames)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if (!frameReady)
+		return false;
+	frameReady = false;
+
+	if (frameSource.pixels != current.pixels ||
+		frameSource.width != current.width ||
+		frameSource.height != current.height ||
+		frameSource.planes != current.planes ||
+		frameSource.step != current.step ||
+		frameSource.sampleRect.left != current.sampleRect.left ||
+		frameSource.sampleRect.top != current.sampleRect.top)
+		return false;
+
+	memcpy(destination, &front[0], front.size());
+	latency = frameLatency;
+	droppedFrames = dropped;
+	dropped = 0;
+	return true;
+}
+
+void PreviewRenderer::Stop(void)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+		generation++;
+	}
+	wake.notify_all();
+	if (thread.joinable())
+		thread.join();
+
+	std::lock_guard<std::mutex> guard(lock);
+	thread = std::thread();
+	frameReady = false;
+	dropped = 0;
+	ready = NULL;
+	context = NULL;
+}
+
+void PreviewRenderer::Main(PreviewRenderer* renderer)
+{
+	renderer->Run();
+}
+
+void PreviewRenderer::Run(void)
+{
+	std::unique_lock<std::mutex> guard(lock);
+
+	for (;;)
+	{
+		while (!quit && rendered == generation)
+			wake.wait(guard);
+
+		// let a burst of edits settle, every new one moves requestedAt on
+		while (!quit && burst)
+		{
+			PipelineClock::time_point quietAt = requestedAt + kPreviewDebounce;
+			if (PipelineClock::now() >= quietAt)
+				break;
+			wake.wait_until(guard, quietAt);
+		}
+		if (quit)
+			return;
+
+		uint32 target = generation;
+		rendered = target;
+		burst = false;
+		PreviewSource from = source;
+		Parameters with = params;
+		PipelineClock::time_point asked = requestedAt;
+
+		guard.unlock();
+		bool finished = Render(from, with, target);
+		guard.lock();
+
+		if (!finished || target != generation)
+		{
+			dropped++;
+			continue;
+		}
+
+		back.swap(front);
+		frameSource = from;
+		frameLatency = MillisecondsSince(asked);
+		frameReady = true;
+
+		PreviewReadyProc readyProc = ready;
+		void* readyContext = context;
+		guard.unlock();
+		if (readyProc != NULL)
+			readyProc(readyContext);
+		guard.lock();
+	}
+}
+
+//-------------------------------------------------------------------------------
+//
+// Render
+//
+// Copy the source into the back buffer a strip at a time and invert it the
+// way UpdateProxyBuffer would, giving up as soon as a newer request comes in.
+//
+//-------------------------------------------------------------------------------
+bool PreviewRenderer::Render(const PreviewSource& from, const Parameters& with, uint32 target)
+{
+	try
+	{
+		back.resize((size_t)from.planeSize * from.planes);
+	}
+	catch (...)
+	{
+		return false;
+	}
+
+	for (int32 top = 0; top < from.height; top += kPreviewStripRows)
+	{
+		if (generation != target)
+			return false;
+
+		int32 rows = from.height - top;
+		if (rows > kPreviewStripRows)
+			rows = kPreviewStripRows;
+
+		VRect stripRect = from.sampleRect;
+		stripRect.top += top;
+		stripRect.bottom = stripRect.top + rows;
+
+		size_t offset = (size_t)top * from.width;
+		uint8* mask = from.mask != NULL ? (uint8*)from.mask + offset : NULL;
+
+		for (int32 plane = 0; plane < from.planes; plane++)
+		{
+			uint8* strip = &back[0] + (size_t)plane * from.planeSize + offset;
+			memcpy(strip, from.pixels + (size_t)plane * from.planeSize + offset, (size_t)rows * from.width);
+			InvertRectangle(with, strip, from.width, mask, from.width, stripRect, 8, 1, from.step);
+		}
+	}
+
+	return generation == target;
+}
+
+// the cache ReadProxySource filled, NULL pixels when there isn't one
+static void GetPreviewSource(PreviewSource& source)
+{
+	memset(&source, 0, sizeof(source));
+	if (gData->proxySource == NULL)
+		return;
+
+	source.pixels = (const uint8*)gData->proxySource;
+	source.width = gData->proxySourceWidth;
+	source.height = gData->proxySourceHeight;
+	source.planeSize = source.width * source.height;
+	source.planes = gFilterRecord->planes;
+	if (gData->proxySourceMasked)
+		source.mask = source.pixels + (size_t)source.planeSize * source.planes;
+
+	source.step = gData->proxySourceRate >> 16;
+	if (source.step < 1)
+		source.step = 1;
+
+	source.sampleRect = gData->proxySourceRect;
+	source.sampleRect.right = source.sampleRect.left + source.width;
+	source.sampleRect.bottom = source.sampleRect.top + source.height;
+}
+
+Boolean RequestPreview(PreviewReadyProc ready, void* context)
+{
+	PreviewSource source;
+	GetPreviewSource(source);
+	if (source.pixels == NULL || gData->proxyBuffer == NULL || source.planeSize <= 0)
+		return false;
+
+	return gPreviewRenderer.Request(source, *gParams, ready, context);
+}
+
+Boolean TakePreviewFrame(void)
+{
+	PreviewSource current;
+	GetPreviewSource(current);
+	if (current.pixels == NULL || gData->proxyBuffer == NULL ||
+		gData->proxyWidth != current.width || gData->proxyHeight != current.height)
+		return false;
+
+	double latency = 0;
+	int32 dropped = 0;
+	if (!gPreviewRenderer.Take((uint8*)gData->proxyBuffer, current, latency, dropped))
+		return false;
+
+	// the frame's parameters aren't known here, the next UpdateProxyBuffer
+	// has to count as a change
+	gData->proxyGeneration++;
+	gData->proxyParamsSource = 0;
+	RecordPreviewFrame(latency, current.width, current.height);
+	RecordDroppedFrames(dropped);
+
+	return true;
+}
+
+void StopPreviewRenderer(void)
+{
+	gPreviewRenderer.Stop();
+}
+
+// end InvertPreview.cpp
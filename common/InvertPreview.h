@@ -0,0 +1,33 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+#ifndef _INVERTPREVIEW_H
+#define _INVERTPREVIEW_H
+
+#include "Invert.h"
+
+// Called on the renderer's thread when a frame is waiting for
+// TakePreviewFrame. Post something to the dialog's thread and return.
+typedef void (*PreviewReadyProc)(void* context);
+
+// Render the current parameters from the proxy source cache on a background
+// thread, cancelling any frame still in progress. Returns false when there is
+// no cache to render from and the caller should redraw the old way.
+Boolean RequestPreview(PreviewReadyProc ready, void* context);
+
+// Copy the newest finished frame into proxyBuffer. Returns false when there
+// isn't one or it was rendered for another proxy.
+Boolean TakePreviewFrame(void);
+
+// Cancel and join the renderer. Done before the proxy source is freed.
+void StopPreviewRenderer(void);
+
+#endif
+// end InvertPreview.h
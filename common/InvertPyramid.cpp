@@ -0,0 +1,740 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertPyramid.h"
+#include "InvertKernels.h"
+#include "InvertPreview.h"
+#include "InvertBuffers.h"
+#include "FilterBigDocument.h"
+#include <map>
+#include <vector>
+#include <string.h>
+
+//-------------------------------------------------------------------------------
+//
+// Proxy pyramid
+//
+// Zoomed all the way out the proxy shows the whole filter rectangle at the
+// rate that fits it in the dialog. Each step in halves the rate, down to one
+// document pixel per proxy pixel, and the proxy becomes a window onto that
+// level that can be panned. A level is read through inputRate a tile of
+// kPyramidTile level pixels at a time, only when a view needs it, and kept,
+// so going back to somewhere already seen costs no host call. The tiles a
+// view is missing are read together, one advanceState per plane over their
+// bounding box.
+//
+// Tiles hold the 8 bit proxy source, mask after the planes, in buffers from
+// the host so its memory accounting and ours see them. Once they would take
+// more than kMaxPyramidBytes, or half of what the host has free, the least
+// recently shown go first.
+//
+//-------------------------------------------------------------------------------
+const int32 kPyramidTile = 128;
+const int64 kMaxPyramidBytes = (int64)1 << 26;
+
+typedef struct PyramidKey
+{
+	int32 rate;
+	int32 column;
+	int32 row;
+
+	bool operator<(const PyramidKey& other) const
+	{
+		if (rate != other.rate)
+			return rate < other.rate;
+		if (row != other.row)
+			return row < other.row;
+		return column < other.column;
+	}
+} PyramidKey;
+
+// one tile of a level, planes then the mask, each the size of rect
+typedef struct PyramidTile
+{
+	VRect rect;
+	BufferID bufferID;
+	int64 capacity;
+	uint8* pixels;
+	uint32 lastUse;
+} PyramidTile;
+
+typedef std::map<PyramidKey, PyramidTile> PyramidTiles;
+
+static PyramidTiles gPyramidTiles;
+static int64 gPyramidBytes = 0;
+static uint32 gPyramidClock = 0;
+static Boolean gPyramidMasked = false;
+static Boolean gPyramidDithered = false;
+
+// the rate the whole filter rect fits the proxy at, as SetupFilterRecordForProxy has it
+static int32 FitRate(void)
+{
+	int32 rate = (int32)gData->scaleFactor;
+	return rate < 1 ? 1 : rate;
+}
+
+static int32 MaxZoom(int32 fitRate)
+{
+	int32 zoom = 0;
+	while ((fitRate >> (zoom + 1)) >= 1)
+		zoom++;
+	return zoom;
+}
+
+static int32 ViewRate(void)
+{
+	int32 rate = gFilterRecord->inputRate >> 16;
+	return rate < 1 ? 1 : rate;
+}
+
+// the filter rect in pixels of the level sampled every rate document pixels
+static VRect LevelBounds(int32 rate)
+{
+	VRect bounds = GetFilterRect();
+	bounds.left /= rate;
+	bounds.top /= rate;
+	bounds.right /= rate;
+	bounds.bottom /= rate;
+	return bounds;
+}
+
+//-------------------------------------------------------------------------------
+//
+// SetupProxyView
+//
+// Zoomed in, the view is a proxy sized window on the level, centred on
+// proxyCenter as far as the level's edges allow. The centre is moved to where
+// the view ended up so panning past an edge doesn't build up.
+//
+//-------------------------------------------------------------------------------
+void SetupProxyView(void)
+{
+	int32 fitRate = FitRate();
+	int32 maxZoom = MaxZoom(fitRate);
+	if (gData->proxyZoom > maxZoom)
+		gData->proxyZoom = maxZoom;
+	if (gData->proxyZoom < 0)
+		gData->proxyZoom = 0;
+
+	if (gData->proxyZoom == 0)
+	{
+		// the whole filter rect, already set up at the fit rate
+		VRect filterRect = GetFilterRect();
+		gData->proxyCenter.h = (filterRect.left + filterRect.right) / 2;
+		gData->proxyCenter.v = (filterRect.top + filterRect.bottom) / 2;
+		return;
+	}
+
+	int32 rate = fitRate >> gData->proxyZoom;
+	VRect bounds = LevelBounds(rate);
+
+	int32 width = gData->proxyWidth;
+	int32 height = gData->proxyHeight;
+	if (width > bounds.right - bounds.left)
+		width = bounds.right - bounds.left;
+	if (height > bounds.bottom - bounds.top)
+		height = bounds.bottom - bounds.top;
+
+	VRect view;
+	view.left = gData->proxyCenter.h / rate - width / 2;
+	view.top = gData->proxyCenter.v / rate - height / 2;
+	if (view.left > bounds.right - width)
+		view.left = bounds.right - width;
+	if (view.top > bounds.bottom - height)
+		view.top = bounds.bottom - height;
+	if (view.left < bounds.left)
+		view.left = bounds.left;
+	if (view.top < bounds.top)
+		view.top = bounds.top;
+	view.right = view.left + width;
+	view.bottom = view.top + height;
+
+	SetInRect(view);
+	SetMaskRect(view);
+	gFilterRecord->inputRate = rate << 16;
+	gFilterRecord->maskRate = rate << 16;
+
+	gData->proxyWidth = width;
+	gData->proxyHeight = height;
+	gData->proxyPlaneSize = width * height;
+	gData->proxyCenter.h = (view.left + width / 2) * rate;
+	gData->proxyCenter.v = (view.top + height / 2) * rate;
+}
+
+//-------------------------------------------------------------------------------
+//
+// ZoomProxy
+//
+// A frame the renderer drew for the old view must not be shown over the new
+// one, so it is stopped here rather than when the view is read.
+//
+//-------------------------------------------------------------------------------
+Boolean ZoomProxy(int32 steps, int32 h, int32 v)
+{
+	int32 fitRate = FitRate();
+	int32 zoom = gData->proxyZoom + steps;
+	int32 maxZoom = MaxZoom(fitRate);
+	if (zoom > maxZoom)
+		zoom = maxZoom;
+	if (zoom < 0)
+		zoom = 0;
+	if (zoom == gData->proxyZoom)
+		return false;
+
+	int32 oldRate = ViewRate();
+	int32 newRate = fitRate >> zoom;
+	VRect view = GetInRect();
+
+	// the document pixel under (h, v)
+	int32 documentH = (view.left + h) * oldRate;
+	int32 documentV = (view.top + v) * oldRate;
+
+	gData->proxyCenter.h = documentH + (gData->proxyWidth / 2 - h) * newRate;
+	gData->proxyCenter.v = documentV + (gData->proxyHeight / 2 - v) * newRate;
+	gData->proxyZoom = zoom;
+
+	StopPreviewRenderer();
+	return true;
+}
+
+Boolean PanProxy(int32 h, int32 v)
+{
+	if (gData->proxyZoom == 0)
+		return false;
+
+	int32 rate = ViewRate();
+	gData->proxyCenter.h += h * rate;
+	gData->proxyCenter.v += v * rate;
+
+	StopPreviewRenderer();
+	return true;
+}
+
+// give a tile's buffer back and forget it
+static void FreeTile(PyramidTiles::iterator t)
+{
+	gPyramidBytes -= t->second.capacity;
+	ReleaseBuffer(t->second.bufferID, t->second.capacity);
+	gPyramidTiles.erase(t);
+}
+
+// what the cache may hold, never more than half of what the host has free
+static int64 PyramidBudget(void)
+{
+	int64 budget = (HostBufferSpace64(gFilterRecord->bufferProcs) + gPyramidBytes) / 2;
+	return budget < kMaxPyramidBytes ? budget : kMaxPyramidBytes;
+}
+
+// drop the least recently shown tiles until needed more bytes fit, never one
+// the view being read uses
+static void EvictTiles(int64 needed)
+{
+	int64 budget = PyramidBudget();
+	while (gPyramidBytes + needed > budget)
+	{
+		PyramidTiles::iterator oldest = gPyramidTiles.end();
+		for (PyramidTiles::iterator t = gPyramidTiles.begin(); t != gPyramidTiles.end(); ++t)
+		{
+			if (t->second.lastUse != gPyramidClock &&
+				(oldest == gPyramidTiles.end() || t->second.lastUse < oldest->second.lastUse))
+				oldest = t;
+		}
+		if (oldest == gPyramidTiles.end())
+			return;
+
+		FreeTile(oldest);
+	}
+}
+
+static void DropTiles(const std::vector<PyramidKey>& keys)
+{
+	for (size_t k = 0; k < keys.size(); k++)
+	{
+		PyramidTiles::iterator t = gPyramidTiles.find(keys[k]);
+		if (t != gPyramidTiles.end())
+			FreeTile(t);
+	}
+}
+
+//-------------------------------------------------------------------------------
+//
+// ReadPyramidTiles
+//
+// Read the tiles of the level at rate in columns missing.left to
+// missing.right and rows missing.top to missing.bottom that aren't cached.
+// The dither pattern is lined up with the level, not the tile, so tiles read
+// at different times meet without a seam.
+//
+//-------------------------------------------------------------------------------
+static OSErr ReadPyramidTiles(int32 rate, const VRect& missing, Boolean dither)
+{
+	VRect bounds = LevelBounds(rate);
+	int32 planes = gFilterRecord->planes;
+
+	VRect read;
+	read.left = missing.left * kPyramidTile;
+	read.top = missing.top * kPyramidTile;
+	read.right = missing.right * kPyramidTile;
+	read.bottom = missing.bottom * kPyramidTile;
+	if (read.left < bounds.left)
+		read.left = bounds.left;
+	if (read.top < bounds.top)
+		read.top = bounds.top;
+	if (read.right > bounds.right)
+		read.right = bounds.right;
+	if (read.bottom > bounds.bottom)
+		read.bottom = bounds.bottom;
+
+	int64 tileBytes = (int64)kPyramidTile * kPyramidTile * (planes + 1);
+	EvictTiles(tileBytes * (missing.right - missing.left) * (missing.bottom - missing.top));
+
+	std::vector<PyramidKey> fresh;
+	try
+	{
+		for (int32 row = missing.top; row < missing.bottom; row++)
+		{
+			for (int32 column = missing.left; column < missing.right; column++)
+			{
+				PyramidKey key = { rate, column, row };
+				if (gPyramidTiles.find(key) != gPyramidTiles.end())
+					continue;
+
+				VRect rect;
+				rect.left = column * kPyramidTile;
+				rect.top = row * kPyramidTile;
+				rect.right = rect.left + kPyramidTile;
+				rect.bottom = rect.top + kPyramidTile;
+				if (rect.left < read.left)
+					rect.left = read.left;
+				if (rect.top < read.top)
+					rect.top = read.top;
+				if (rect.right > read.right)
+					rect.right = read.right;
+				if (rect.bottom > read.bottom)
+					rect.bottom = read.bottom;
+
+				fresh.push_back(key);
+				PyramidTile& tile = gPyramidTiles[key];
+				tile.rect = rect;
+				tile.lastUse = gPyramidClock;
+
+				int64 size = (int64)(rect.right - rect.left) * (rect.bottom - rect.top) * (planes + 1);
+				tile.pixels = (uint8*)ReserveBuffer(tile.bufferID, tile.capacity, size);
+				if (tile.pixels == NULL)
+				{
+					DropTiles(fresh);
+					return memFullErr;
+				}
+				gPyramidBytes += tile.capacity;
+			}
+		}
+	}
+	catch (...)
+	{
+		DropTiles(fresh);
+		return memFullErr;
+	}
+
+	ConvertRowProc convertRow = GetConvertRowProc(gKernels, gFilterRecord->depth);
+	int32 sampleBytes = gFilterRecord->depth / 8;
+	if (sampleBytes == 0)
+		sampleBytes = 1;
+
+	SetInRect(read);
+	SetMaskRect(read);
+	gFilterRecord->inputRate = rate << 16;
+	gFilterRecord->maskRate = rate << 16;
+
+	for (int16 plane = 0; plane < planes; plane++)
+	{
+		gFilterRecord->inLoPlane = plane;
+		gFilterRecord->inHiPlane = plane;
+
+		OSErr err = gFilterRecord->advanceState();
+		if (err != noErr)
+		{
+			DropTiles(fresh);
+			return err;
+		}
+
+		const uint8* inData = (const uint8*)gFilterRecord->inData;
+
+		for (size_t f = 0; f < fresh.size(); f++)
+		{
+			PyramidTile& tile = gPyramidTiles[fresh[f]];
+			int32 width = tile.rect.right - tile.rect.left;
+			int32 height = tile.rect.bottom - tile.rect.top;
+			uint8* tilePixel = tile.pixels + (size_t)plane * width * height;
+
+			for (int32 y = tile.rect.top; y < tile.rect.bottom; y++)
+			{
+				uint8 ditherRow[4];
+				if (dither)
+				{
+					const uint8* levelRow = OrderedDitherRow(y);
+					for (int32 d = 0; d < 4; d++)
+						ditherRow[d] = levelRow[(tile.rect.left + d) & 3];
+				}
+
+				const uint8* inPixel = inData + (size_t)(y - read.top) * gFilterRecord->inRowBytes +
+									   (size_t)(tile.rect.left - read.left) * sampleBytes;
+				convertRow(inPixel, tilePixel, width, dither ? ditherRow : NULL);
+				tilePixel += width;
+			}
+		}
+	}
+
+	// the mask doesn't change from plane to plane, the last one will do
+	const uint8* maskData = (const uint8*)gFilterRecord->maskData;
+	gPyramidMasked = maskData != NULL;
+	if (maskData != NULL)
+	{
+		for (size_t f = 0; f < fresh.size(); f++)
+		{
+			PyramidTile& tile = gPyramidTiles[fresh[f]];
+			int32 width = tile.rect.right - tile.rect.left;
+			int32 height = tile.rect.bottom - tile.rect.top;
+			uint8* tilePixel = tile.pixels + (size_t)planes * width * height;
+
+			for (int32 y = tile.rect.top; y < tile.rect.bottom; y++)
+			{
+				memcpy(tilePixel,
+					   maskData + (size_t)(y - read.top) * gFilterRecord->maskRowBytes + (tile.rect.left - read.left),
+					   width);
+				tilePixel += width;
+			}
+		}
+	}
+
+	return noErr;
+}
+
+// columns and rows of the level's tiles under rect
+static VRect TilesUnder(const VRect& rect)
+{
+	VRect tiles;
+	tiles.left = rect.left / kPyramidTile;
+	tiles.top = rect.top / kPyramidTile;
+	tiles.right = (rect.right - 1) / kPyramidTile + 1;
+	tiles.bottom = (rect.bottom - 1) / kPyramidTile + 1;
+	return tiles;
+}
+
+// the columns and rows around the tiles in range that aren't cached, the
+// ones that are get marked as in use
+static bool FindMissingTiles(int32 rate, const VRect& tiles, VRect& missing)
+{
+	bool anyMissing = false;
+	for (int32 row = tiles.top; row < tiles.bottom; row++)
+	{
+		for (int32 column = tiles.left; column < tiles.right; column++)
+		{
+			PyramidKey key = { rate, column, row };
+			PyramidTiles::iterator t = gPyramidTiles.find(key);
+			if (t != gPyramidTiles.end())
+			{
+				t->second.lastUse = gPyramidClock;
+				continue;
+			}
+
+			if (!anyMissing)
+			{
+				missing.left = column;
+				missing.top = row;
+				missing.right = column + 1;
+				missing.bottom = row + 1;
+				anyMissing = true;
+			}
+			if (column < missing.left)
+				missing.left = column;
+			if (column + 1 > missing.right)
+				missing.right = column + 1;
+			if (row + 1 > missing.bottom)
+				missing.bottom = row + 1;
+		}
+	}
+	return anyMissing;
+}
+
+// copy the part of tile under rect into destination, layers planes the size of rect
+static void CopyTile(const PyramidTile& tile, const VRect& rect, uint8* destination, int32 layers)
+{
+	int32 width = rect.right - rect.left;
+	size_t planeSize = (size_t)width * (rect.bottom - rect.top);
+	int32 tileWidth = tile.rect.right - tile.rect.left;
+	int32 tileHeight = tile.rect.bottom - tile.rect.top;
+
+	VRect overlap = tile.rect;
+	if (overlap.left < rect.left)
+		overlap.left = rect.left;
+	if (overlap.top < rect.top)
+		overlap.top = rect.top;
+	if (overlap.right > rect.right)
+		overlap.right = rect.right;
+	if (overlap.bottom > rect.bottom)
+		overlap.bottom = rect.bottom;
+	if (overlap.right <= overlap.left || overlap.bottom <= overlap.top)
+		return;
+
+	int32 overlapWidth = overlap.right - overlap.left;
+	for (int32 layer = 0; layer < layers; layer++)
+	{
+		const uint8* from = &tile.pixels[(size_t)layer * tileWidth * tileHeight] +
+							(size_t)(overlap.top - tile.rect.top) * tileWidth +
+							(overlap.left - tile.rect.left);
+		uint8* to = destination + layer * planeSize +
+					(size_t)(overlap.top - rect.top) * width +
+					(overlap.left - rect.left);
+		for (int32 y = overlap.top; y < overlap.bottom; y++)
+		{
+			memcpy(to, from, overlapWidth);
+			from += tileWidth;
+			to += width;
+		}
+	}
+}
+
+// read what's missing of tiles, then copy them into destination laid out as rect
+static OSErr ReadLevelRect(int32 rate, const VRect& rect, const VRect& tiles, uint8* destination)
+{
+	VRect missing;
+	if (FindMissingTiles(rate, tiles, missing))
+	{
+		OSErr err = ReadPyramidTiles(rate, missing, gPyramidDithered);
+		if (err != noErr)
+			return err;
+	}
+
+	int32 layers = gPyramidMasked ? gFilterRecord->planes + 1 : gFilterRecord->planes;
+	for (int32 row = tiles.top; row < tiles.bottom; row++)
+	{
+		for (int32 column = tiles.left; column < tiles.right; column++)
+		{
+			PyramidKey key = { rate, column, row };
+			CopyTile(gPyramidTiles[key], rect, destination, layers);
+		}
+	}
+	return noErr;
+}
+
+// the view and rates as SetupProxyView left them, after reading other rects
+static void RestoreView(const VRect& view, int32 rate)
+{
+	SetInRect(view);
+	SetMaskRect(view);
+	gFilterRecord->inputRate = rate << 16;
+	gFilterRecord->maskRate = rate << 16;
+}
+
+// a dither setting the tiles weren't read with makes them useless
+static void MatchDither(void)
+{
+	Boolean dither = gData->proxyDither && gFilterRecord->depth > 8;
+	if (dither != gPyramidDithered)
+	{
+		DeletePyramid();
+		gPyramidDithered = dither;
+	}
+}
+
+//-------------------------------------------------------------------------------
+//
+// ReadProxyView
+//
+// Make sure every tile under the view is cached, then copy the view out of
+// them. The in and mask rectangles are put back the way SetupProxyView left
+// them so the proxy source cache can tell what it holds.
+//
+//-------------------------------------------------------------------------------
+OSErr ReadProxyView(uint8* source, Boolean& masked)
+{
+	VRect view = GetInRect();
+	int32 rate = ViewRate();
+	masked = false;
+	if (view.right <= view.left || view.bottom <= view.top)
+		return noErr;
+
+	MatchDither();
+	gPyramidClock++;
+
+	OSErr err = ReadLevelRect(rate, view, TilesUnder(view), source);
+	RestoreView(view, rate);
+
+	masked = gPyramidMasked;
+	return err;
+}
+
+//-------------------------------------------------------------------------------
+//
+// Progressive reads
+//
+// A big view nobody has looked at yet is first filled from the level
+// kCoarseFactor times coarser, a sixteenth of the pixels to read, or
+// kCoarsestFactor times for the biggest proxies, so there is something on
+// screen at once. RefineProxyView then reads the view's own tiles a row of
+// tiles per call and copies each row over the coarse pixels. Anything of the
+// view already cached goes straight in over the coarse fill.
+//
+//-------------------------------------------------------------------------------
+const int32 kProgressivePixels = 1 << 16;
+const int32 kCoarsestPixels = 1 << 19;
+const int32 kCoarseFactor = 4;
+const int32 kCoarsestFactor = 8;
+
+Boolean ProgressiveProxyView(void)
+{
+	VRect view = GetInRect();
+	int32 width = view.right - view.left;
+	int32 height = view.bottom - view.top;
+	if (width <= 0 || height <= 0 || width * height < kProgressivePixels)
+		return false;
+
+	MatchDither();
+	gPyramidClock++;
+
+	VRect missing;
+	return FindMissingTiles(ViewRate(), TilesUnder(view), missing);
+}
+
+OSErr ReadCoarseProxyView(uint8* source, Boolean& masked)
+{
+	VRect view = GetInRect();
+	int32 rate = ViewRate();
+	int32 width = view.right - view.left;
+	int32 height = view.bottom - view.top;
+	int32 planes = gFilterRecord->planes;
+	masked = false;
+	if (width <= 0 || height <= 0)
+		return noErr;
+
+	MatchDither();
+	gPyramidClock++;
+
+	int32 factor = width * height >= kCoarsestPixels ? kCoarsestFactor : kCoarseFactor;
+	int32 coarseRate = rate * factor;
+	VRect bounds = LevelBounds(coarseRate);
+
+	// the coarse pixels the view's pixels fall in
+	VRect coarse;
+	coarse.left = view.left * rate / coarseRate;
+	coarse.top = view.top * rate / coarseRate;
+	coarse.right = (view.right - 1) * rate / coarseRate + 1;
+	coarse.bottom = (view.bottom - 1) * rate / coarseRate + 1;
+	if (coarse.right > bounds.right)
+		coarse.right = bounds.right;
+	if (coarse.bottom > bounds.bottom)
+		coarse.bottom = bounds.bottom;
+	if (coarse.right <= coarse.left || coarse.bottom <= coarse.top)
+		return ReadProxyView(source, masked);
+
+	int32 coarseWidth = coarse.right - coarse.left;
+	int32 coarseHeight = coarse.bottom - coarse.top;
+	std::vector<uint8> coarsePixels;
+	std::vector<int32> columns;
+	try
+	{
+		coarsePixels.resize((size_t)coarseWidth * coarseHeight * (planes + 1));
+		columns.resize(width);
+	}
+	catch (...)
+	{
+		return memFullErr;
+	}
+
+	OSErr err = ReadLevelRect(coarseRate, coarse, TilesUnder(coarse), &coarsePixels[0]);
+	RestoreView(view, rate);
+	if (err != noErr)
+		return err;
+
+	for (int32 x = 0; x < width; x++)
+	{
+		int32 column = (view.left + x) * rate / coarseRate - coarse.left;
+		columns[x] = column < coarseWidth ? column : coarseWidth - 1;
+	}
+
+	int32 layers = gPyramidMasked ? planes + 1 : planes;
+	size_t planeSize = (size_t)width * height;
+	size_t coarsePlaneSize = (size_t)coarseWidth * coarseHeight;
+	for (int32 layer = 0; layer < layers; layer++)
+	{
+		for (int32 y = 0; y < height; y++)
+		{
+			int32 row = (view.top + y) * rate / coarseRate - coarse.top;
+			if (row >= coarseHeight)
+				row = coarseHeight - 1;
+
+			const uint8* from = &coarsePixels[layer * coarsePlaneSize + (size_t)row * coarseWidth];
+			uint8* to = source + layer * planeSize + (size_t)y * width;
+			for (int32 x = 0; x < width; x++)
+				to[x] = from[columns[x]];
+		}
+	}
+
+	// whatever of the view is cached already doesn't have to wait
+	VRect tiles = TilesUnder(view);
+	for (int32 row = tiles.top; row < tiles.bottom; row++)
+	{
+		for (int32 column = tiles.left; column < tiles.right; column++)
+		{
+			PyramidKey key = { rate, column, row };
+			PyramidTiles::iterator t = gPyramidTiles.find(key);
+			if (t != gPyramidTiles.end())
+			{
+				t->second.lastUse = gPyramidClock;
+				CopyTile(t->second, view, source, layers);
+			}
+		}
+	}
+
+	masked = gPyramidMasked;
+	return noErr;
+}
+
+OSErr RefineProxyView(uint8* source, Boolean& more)
+{
+	VRect view = GetInRect();
+	int32 rate = ViewRate();
+	more = false;
+	if (view.right <= view.left || view.bottom <= view.top)
+		return noErr;
+
+	MatchDither();
+	gPyramidClock++;
+
+	// marks the whole view in use so reading a row can't evict the others
+	VRect tiles = TilesUnder(view);
+	VRect missing;
+	if (!FindMissingTiles(rate, tiles, missing))
+		return noErr;
+
+	VRect band = tiles;
+	band.top = missing.top;
+	band.bottom = missing.top + 1;
+
+	OSErr err = ReadLevelRect(rate, view, band, source);
+	RestoreView(view, rate);
+	if (err != noErr)
+		return err;
+
+	more = missing.bottom > band.bottom;
+	return noErr;
+}
+
+void DeletePyramid(void)
+{
+	while (!gPyramidTiles.empty())
+		FreeTile(gPyramidTiles.begin());
+	PyramidTiles().swap(gPyramidTiles);
+	gPyramidBytes = 0;
+	gPyramidMasked = false;
+}
+
+// end InvertPyramid.cpp
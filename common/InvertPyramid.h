@@ -0,0 +1,48 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+#ifndef _INVERTPYRAMID_H
+#define _INVERTPYRAMID_H
+
+#include "Invert.h"
+
+// Point the filter record's in and mask rectangles and rates at the proxy's
+// zoom and pan. SetupFilterRecordForProxy calls this once it has the fit.
+void SetupProxyView(void);
+
+// Zoom in (steps > 0) or out about proxy pixel (h, v), which stays over the
+// same document pixel where it can. Returns false when the zoom can't change.
+Boolean ZoomProxy(int32 steps, int32 h, int32 v);
+
+// Move the view by h, v proxy pixels. Returns false when zoomed all the way
+// out and there is nothing to move.
+Boolean PanProxy(int32 h, int32 v);
+
+// Fill source, 8 bit planes then the mask, with the view SetupProxyView set
+// up. Tiles of the level already cached are not read from the host again.
+OSErr ReadProxyView(uint8* source, Boolean& masked);
+
+// True when the view is big and not cached yet, so it is worth showing a
+// coarse frame before reading it all.
+Boolean ProgressiveProxyView(void);
+
+// Fill source with the view sampled from a coarser level, plus whatever of the
+// view's own tiles are cached already.
+OSErr ReadCoarseProxyView(uint8* source, Boolean& masked);
+
+// Read the next row of the view's tiles that isn't cached and copy it into
+// source. more is false once the whole view is in.
+OSErr RefineProxyView(uint8* source, Boolean& more);
+
+// Free every cached tile, at the end of the dialog.
+void DeletePyramid(void);
+
+#endif
+// end InvertPyramid.h
@@ -33,6 +33,7 @@ SPErr ReadRegistryParameters(void)
 	DescriptorEnumTypeID type;
 	DescriptorEnumID disposition;
 	Boolean ignoreSelection;
+	int32 seed;
 
 	if (basicSuite == NULL)
 		return errPlugInHostInsufficient;
@@ -72,6 +73,13 @@ SPErr ReadRegistryParameters(void)
 	if (err) goto returnError;
 	gParams->ignoreSelection = ignoreSelection;
 
+	// last so entries written before there was a seed still read the rest
+	err = descriptorProcs->GetInteger(descriptor, 
+		                              keyRandomSeed, 
+									  &seed);
+	if (err) goto returnError;
+	gParams->seed = seed;
+
 returnError:
 	if (descriptor != NULL)
 		descriptorProcs->Free(descriptor);
@@ -138,6 +146,11 @@ SPErr WriteRegistryParameters(void)
 									  gParams->ignoreSelection);
 	if (err) goto returnError;
 
+	err = descriptorProcs->PutInteger(descriptor, 
+		                              keyRandomSeed, 
+									  gParams->seed);
+	if (err) goto returnError;
+
 	err = registryProcs->Register(plugInUniqueID, descriptor, true);
 	if (err) goto returnError;
 
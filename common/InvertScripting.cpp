@@ -30,6 +30,7 @@ OSErr ReadScriptParameters(Boolean* displayDialog)
 	double percent;
 	DescriptorEnumID disposition;
 	Boolean ignoreSelection;
+	int32 seed;
 	DescriptorKeyIDArray array = { keyAmount, keyDisposition, 0 };
 
 	if (displayDialog != NULL)
@@ -73,6 +74,11 @@ OSErr ReadScriptParameters(Boolean* displayDialog)
 						if (!err)
 							gParams->ignoreSelection = ignoreSelection;
 						break;
+					case keyRandomSeed:
+						err = readProcs->getIntegerProc(token, &seed);
+						if (!err)
+							gParams->seed = seed;
+						break;
 					default:
 						err = readErr;
 						break;
@@ -121,6 +127,9 @@ OSErr WriteScriptParameters(void)
 			                          keyDisposition, 
 									  typeMood, 
 									  DialogToScript(gParams->disposition));
+		writeProcs->putIntegerProc(token, 
+			                       keyRandomSeed, 
+								   gParams->seed);
 		if (gParams->ignoreSelection)
 			writeProcs->putBooleanProc(token, 
 			                           keyIgnoreSelection, 
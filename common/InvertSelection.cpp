@@ -0,0 +1,228 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertSelection.h"
+#include "InvertKernels.h"
+#include "FilterBigDocument.h"
+
+//-------------------------------------------------------------------------------
+//
+// Selection probe
+//
+// A small selection on a large image would otherwise have us fetch and walk
+// every pixel of the filter rectangle. The mask is one byte a pixel against
+// two copies of every plane for the image, so we read it first, on its own,
+// and note for each host tile whether nothing, everything or some of it is
+// selected. The filter loop then plans only the selection's bounding box,
+// never asks for tiles with nothing selected and inverts fully selected ones
+// without looking at the mask.
+//
+// The mask is read at full resolution. A coarser maskRate would be cheaper
+// but the host samples, so a thin selection could fall between samples and
+// its tile would be skipped.
+//
+//-------------------------------------------------------------------------------
+const int64 kMaxProbeBytes = (int64)1 << 26;
+
+enum
+{
+	sawSkip = 1 << spanSkip,
+	sawFull = 1 << spanFull,
+	sawPartial = 1 << spanPartial
+};
+
+static void WidenBounds(VRect& bounds, int32 left, int32 right, int32 y)
+{
+	if (bounds.right <= bounds.left)
+	{
+		bounds.left = left;
+		bounds.right = right;
+		bounds.top = y;
+		bounds.bottom = y + 1;
+		return;
+	}
+	if (left < bounds.left)
+		bounds.left = left;
+	if (right > bounds.right)
+		bounds.right = right;
+	if (y < bounds.top)
+		bounds.top = y;
+	if (y + 1 > bounds.bottom)
+		bounds.bottom = y + 1;
+}
+
+// note the spans of one mask row in the cells they fall in
+static void ScanMaskRow(SelectionMap& map, const VRect& area, const uint8* row, int32 y)
+{
+	int32 cellRow = (y - map.origin.v) / map.cellHeight;
+	uint8* cells = &map.cells[(size_t)cellRow * map.cellsHoriz];
+
+	for (int32 cellColumn = 0; cellColumn < map.cellsHoriz; cellColumn++)
+	{
+		int32 start = map.origin.h + cellColumn * map.cellWidth;
+		int32 end = start + map.cellWidth;
+		if (start < area.left)
+			start = area.left;
+		if (end > area.right)
+			end = area.right;
+
+		start -= area.left;
+		end -= area.left;
+		while (start < end)
+		{
+			MaskSpanKind kind;
+			int32 next = NextMaskSpan(gKernels, row, start, end, kind);
+			cells[cellColumn] |= (uint8)(1 << kind);
+			if (kind != spanSkip)
+				WidenBounds(map.bounds, area.left + start, area.left + next, y);
+			start = next;
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------
+//
+// ProbeSelection
+//
+// Strips of whole cell rows, as many as the budget takes, with empty in and
+// out rectangles so the host only moves the mask. A host that gives us no
+// mask data leaves the map saying everything is worth a look.
+//
+//-------------------------------------------------------------------------------
+OSErr ProbeSelection(SelectionMap& map, int64 budget)
+{
+	VRect area = GetFilterRect();
+	VRect noRect = { 0, 0, 0, 0 };
+
+	GetHostTile(map.cellWidth, map.cellHeight, map.origin);
+	map.origin.h = GridStart(area.left, map.origin.h, map.cellWidth);
+	map.origin.v = GridStart(area.top, map.origin.v, map.cellHeight);
+	map.cellsHoriz = CountSteps(map.origin.h, area.right, map.cellWidth);
+	map.cellsVert = CountSteps(map.origin.v, area.bottom, map.cellHeight);
+	map.cells.assign((size_t)map.cellsHoriz * map.cellsVert, 0);
+	map.bounds = noRect;
+
+	int32 areaWidth = area.right - area.left;
+	if (map.cells.empty() || areaWidth <= 0)
+		return noErr;
+
+	int64 stripBytes = (int64)areaWidth * map.cellHeight;
+	int64 maxBytes = budget < kMaxProbeBytes ? budget : kMaxProbeBytes;
+	int64 rows = maxBytes / stripBytes;
+	if (rows < 1)
+		rows = 1;
+	if (rows > map.cellsVert)
+		rows = map.cellsVert;
+
+	SetInRect(noRect);
+	SetOutRect(noRect);
+	gFilterRecord->maskRate = (int32)1 << 16;
+
+	for (int32 cellRow = 0; cellRow < map.cellsVert; cellRow += (int32)rows)
+	{
+		VRect strip = area;
+		strip.top = map.origin.v + cellRow * map.cellHeight;
+		strip.bottom = strip.top + (int32)rows * map.cellHeight;
+		if (strip.top < area.top)
+			strip.top = area.top;
+		if (strip.bottom > area.bottom)
+			strip.bottom = area.bottom;
+
+		SetMaskRect(strip);
+
+		OSErr err = gFilterRecord->advanceState();
+		if (err != noErr)
+		{
+			SetMaskRect(noRect);
+			return err;
+		}
+
+		const uint8* mask = (const uint8*)gFilterRecord->maskData;
+		if (mask == NULL)
+		{
+			map.cells.assign(map.cells.size(), sawPartial);
+			map.bounds = area;
+			break;
+		}
+
+		for (int32 y = strip.top; y < strip.bottom; y++)
+			ScanMaskRow(map, area, mask + (size_t)(y - strip.top) * gFilterRecord->maskRowBytes, y);
+
+		if (gFilterRecord->abortProc())
+		{
+			SetMaskRect(noRect);
+			return userCanceledErr;
+		}
+	}
+
+	SetMaskRect(noRect);
+
+	for (size_t c = 0; c < map.cells.size(); c++)
+	{
+		uint8 seen = map.cells[c];
+		if (seen == sawSkip)
+			map.cells[c] = coverageEmpty;
+		else if (seen == sawFull)
+			map.cells[c] = coverageFull;
+		else
+			map.cells[c] = coverageMixed;
+	}
+
+	return noErr;
+}
+
+//-------------------------------------------------------------------------------
+//
+// CoverTiles
+//
+// The plan's tiles are whole host tiles on the same grid as the cells, so a
+// tile is empty or full when every cell under it is.
+//
+//-------------------------------------------------------------------------------
+void CoverTiles(TilePlan& plan, const SelectionMap& map)
+{
+	int32 tiles = TileCount(plan);
+	plan.coverage.assign(tiles, coverageMixed);
+
+	for (int32 tile = 0; tile < tiles; tile++)
+	{
+		VRect rect = GetTileRect(plan, tile);
+		if (rect.right <= rect.left || rect.bottom <= rect.top)
+		{
+			plan.coverage[tile] = coverageEmpty;
+			continue;
+		}
+
+		int32 firstColumn = (rect.left - map.origin.h) / map.cellWidth;
+		int32 lastColumn = (rect.right - 1 - map.origin.h) / map.cellWidth;
+		int32 firstRow = (rect.top - map.origin.v) / map.cellHeight;
+		int32 lastRow = (rect.bottom - 1 - map.origin.v) / map.cellHeight;
+
+		bool allEmpty = true;
+		bool allFull = true;
+		for (int32 row = firstRow; row <= lastRow; row++)
+		{
+			for (int32 column = firstColumn; column <= lastColumn; column++)
+			{
+				uint8 cell = map.cells[(size_t)row * map.cellsHoriz + column];
+				allEmpty = allEmpty && cell == coverageEmpty;
+				allFull = allFull && cell == coverageFull;
+			}
+		}
+
+		if (allEmpty)
+			plan.coverage[tile] = coverageEmpty;
+		else if (allFull)
+			plan.coverage[tile] = coverageFull;
+	}
+}
+
+// end InvertSelection.cpp
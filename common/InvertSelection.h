@@ -0,0 +1,37 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+#ifndef _INVERTSELECTION_H
+#define _INVERTSELECTION_H
+
+#include "Invert.h"
+#include "InvertTiles.h"
+#include <vector>
+
+// the selection summed up per host tile, or cell
+typedef struct SelectionMap
+{
+	VRect bounds;			// every selected pixel, empty when there are none
+	VPoint origin;			// corner of the first cell, on a host tile corner
+	int32 cellWidth;
+	int32 cellHeight;
+	int32 cellsHoriz;
+	int32 cellsVert;
+	std::vector<uint8> cells;	// a Coverage per cell
+} SelectionMap;
+
+// read the mask on its own, no image planes, and map out the selection
+OSErr ProbeSelection(SelectionMap& map, int64 budget);
+
+// fill in the coverage of every tile in plan
+void CoverTiles(TilePlan& plan, const SelectionMap& map);
+
+#endif
+// end InvertSelection.h
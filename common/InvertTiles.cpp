@@ -0,0 +1,221 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertTiles.h"
+#include "InvertPipeline.h"
+#include "FilterBigDocument.h"
+#include "PIProperties.h"
+
+//-------------------------------------------------------------------------------
+//
+// Tile planning
+//
+// Photoshop keeps the document in tiles of its own. A request that starts or
+// ends inside one of them costs a copy of the whole tile, and every request
+// costs an advanceState round trip, so we ask for as few and as large
+// requests as the memory budget allows, built out of whole host tiles and
+// lined up on the host's tile grid. Wide documents get strips the full width
+// of the filter rectangle, they only fall back to narrower tiles when a
+// single row of host tiles doesn't fit.
+//
+//-------------------------------------------------------------------------------
+const int32 kDefaultHostTile = 256;
+const int32 kMinHostTile = 64;
+const int64 kMaxRequestBytes = (int64)1 << 28;
+const int32 kMinPipelineTiles = 4;
+
+// where the host keeps its tiles, from the filter record or the tile size
+// property for hosts that leave the tile fields at zero
+void GetHostTile(int32& width, int32& height, VPoint& origin)
+{
+	width = gFilterRecord->outTileWidth;
+	height = gFilterRecord->outTileHeight;
+	origin.h = gFilterRecord->outTileOrigin.h;
+	origin.v = gFilterRecord->outTileOrigin.v;
+
+	if (width > 0 && height > 0)
+		return;
+
+	width = height = kDefaultHostTile;
+	origin.h = origin.v = 0;
+
+	intptr_t tileBytes = 0;
+	if (gFilterRecord->propertyProcs != NULL &&
+		gFilterRecord->propertyProcs->getPropertyProc != NULL &&
+		gFilterRecord->propertyProcs->getPropertyProc(kPhotoshopSignature,
+													  propTileSize,
+													  0,
+													  &tileBytes,
+													  NULL) == noErr &&
+		tileBytes > 0)
+	{
+		// square power of two tiles of one plane
+		int32 sampleBytes = gFilterRecord->depth / 8;
+		int32 side = kMinHostTile;
+		while ((int64)side * 2 * side * 2 * sampleBytes <= (int64)tileBytes)
+			side *= 2;
+		width = height = side;
+	}
+}
+
+//-------------------------------------------------------------------------------
+//
+// PlanTiles
+//
+// Three ways to run, tried in order: all planes per request with the worker
+// pipeline's two slots on top, all planes on the calling thread, and one
+// plane per request. The first whose smallest tile, one host tile, fits the
+// budget wins and its tiles then grow in whole host tiles until the budget,
+// or the per-request cap, is used up. The pipeline also wants a few tiles to
+// overlap, so it won't take the whole image in one request.
+//
+//-------------------------------------------------------------------------------
+void PlanTiles(TilePlan& plan, const VRect& area, int64 budget)
+{
+	int32 hostWidth, hostHeight;
+	GetHostTile(hostWidth, hostHeight, plan.origin);
+
+	plan.area = area;
+	plan.coverage.clear();
+	int32 areaWidth = plan.area.right - plan.area.left;
+	int32 areaHeight = plan.area.bottom - plan.area.top;
+
+	int32 gridLeft = GridStart(plan.area.left, plan.origin.h, hostWidth);
+	int32 gridTop = GridStart(plan.area.top, plan.origin.v, hostHeight);
+	int32 hostColumns = CountSteps(gridLeft, plan.area.right, hostWidth);
+	int32 hostRows = CountSteps(gridTop, plan.area.bottom, hostHeight);
+
+	int64 sampleBytes = gFilterRecord->depth / 8;
+	int64 pixelBytes = sampleBytes * gFilterRecord->planes;
+	int64 maskBytes = gFilterRecord->haveMask ? 1 : 0;
+	int64 hostTilePixels = (int64)hostWidth * hostHeight;
+
+	int64 hostCost = 2 * sampleBytes + maskBytes;
+	int64 bufferCost = 0;
+	plan.allPlanes = false;
+	plan.pipeline = false;
+
+	if (InvertWorkerCount() > 0 &&
+		budget >= hostTilePixels * (2 * pixelBytes + maskBytes + 2 * (pixelBytes + 1)))
+	{
+		plan.allPlanes = true;
+		plan.pipeline = true;
+		hostCost = 2 * pixelBytes + maskBytes;
+		bufferCost = 2 * (pixelBytes + 1);
+	}
+	else if (budget >= hostTilePixels * (2 * pixelBytes + maskBytes))
+	{
+		plan.allPlanes = true;
+		hostCost = 2 * pixelBytes + maskBytes;
+	}
+
+	int64 maxPixels = budget / (hostCost + bufferCost);
+	if (maxPixels * hostCost > kMaxRequestBytes)
+		maxPixels = kMaxRequestBytes / hostCost;
+	if (plan.pipeline && maxPixels > (int64)areaWidth * areaHeight / kMinPipelineTiles)
+		maxPixels = (int64)areaWidth * areaHeight / kMinPipelineTiles;
+
+	int64 stripPixels = (int64)hostColumns * hostWidth * hostHeight;
+	if (stripPixels > 0 && stripPixels <= maxPixels)
+	{
+		int64 rows = maxPixels / stripPixels;
+		if (rows > hostRows)
+			rows = hostRows;
+		plan.tileWidth = hostColumns * hostWidth;
+		plan.tileHeight = (int32)rows * hostHeight;
+	}
+	else
+	{
+		int64 columns = maxPixels / hostTilePixels;
+		if (columns < 1)
+			columns = 1;
+		plan.tileWidth = (int32)columns * hostWidth;
+		plan.tileHeight = hostHeight;
+	}
+
+	plan.origin.h = gridLeft;
+	plan.origin.v = gridTop;
+	plan.tilesHoriz = CountSteps(gridLeft, plan.area.right, plan.tileWidth);
+	plan.tilesVert = CountSteps(gridTop, plan.area.bottom, plan.tileHeight);
+
+	int64 tilePixels = (int64)plan.tileWidth * plan.tileHeight;
+	plan.hostBytes = tilePixels * hostCost;
+	plan.bufferBytes = tilePixels * bufferCost;
+}
+
+//-------------------------------------------------------------------------------
+//
+// PlanGridTiles
+//
+// One request per tile of a grid the host handed us, for engines that talk to
+// the host's tiles directly and have no advanceState budget to fill.
+//
+//-------------------------------------------------------------------------------
+void PlanGridTiles(TilePlan& plan, VPoint tileOrigin, VPoint tileSize)
+{
+	plan.area = GetFilterRect();
+	plan.tileWidth = tileSize.h;
+	plan.tileHeight = tileSize.v;
+	plan.origin.h = GridStart(plan.area.left, tileOrigin.h, tileSize.h);
+	plan.origin.v = GridStart(plan.area.top, tileOrigin.v, tileSize.v);
+	plan.tilesHoriz = CountSteps(plan.origin.h, plan.area.right, plan.tileWidth);
+	plan.tilesVert = CountSteps(plan.origin.v, plan.area.bottom, plan.tileHeight);
+	plan.allPlanes = true;
+	plan.pipeline = false;
+	plan.hostBytes = 0;
+	plan.bufferBytes = 0;
+	plan.coverage.clear();
+}
+
+int32 TileCount(const TilePlan& plan)
+{
+	return plan.tilesHoriz * plan.tilesVert;
+}
+
+Coverage GetTileCoverage(const TilePlan& plan, int32 tile)
+{
+	if (tile < 0 || tile >= (int32)plan.coverage.size())
+		return coverageMixed;
+	return (Coverage)plan.coverage[tile];
+}
+
+//-------------------------------------------------------------------------------
+//
+// GetTileRect
+//
+// Tiles go left to right, then top to bottom. The grid starts on a host tile
+// corner so the edge tiles are clipped to the filter rectangle.
+//
+//-------------------------------------------------------------------------------
+VRect GetTileRect(const TilePlan& plan, int32 tile)
+{
+	int32 vertTile = tile / plan.tilesHoriz;
+	int32 horizTile = tile % plan.tilesHoriz;
+
+	VRect tileRect;
+	tileRect.top = plan.origin.v + vertTile * plan.tileHeight;
+	tileRect.left = plan.origin.h + horizTile * plan.tileWidth;
+	tileRect.bottom = tileRect.top + plan.tileHeight;
+	tileRect.right = tileRect.left + plan.tileWidth;
+
+	if (tileRect.top < plan.area.top)
+		tileRect.top = plan.area.top;
+	if (tileRect.left < plan.area.left)
+		tileRect.left = plan.area.left;
+	if (tileRect.bottom > plan.area.bottom)
+		tileRect.bottom = plan.area.bottom;
+	if (tileRect.right > plan.area.right)
+		tileRect.right = plan.area.right;
+
+	return tileRect;
+}
+
+// end InvertTiles.cpp
@@ -0,0 +1,69 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+#ifndef _INVERTTILES_H
+#define _INVERTTILES_H
+
+#include "Invert.h"
+#include <vector>
+
+// how much of a tile the selection covers
+typedef enum Coverage
+{
+	coverageMixed = 0,		// some of it, or we don't know
+	coverageEmpty,
+	coverageFull
+} Coverage;
+
+// how the filter rectangle is cut into requests
+typedef struct TilePlan
+{
+	VRect area;				// the filter rectangle
+	VPoint origin;			// a grid corner, on a host tile corner
+	int32 tileWidth;		// whole host tiles, edge tiles are clipped to area
+	int32 tileHeight;
+	int32 tilesHoriz;
+	int32 tilesVert;
+	Boolean allPlanes;		// every plane in one advanceState
+	Boolean pipeline;		// room for the worker pipeline's slots
+	int64 hostBytes;		// in, out and mask of one request
+	int64 bufferBytes;		// plug-in buffers the pipeline allocates
+	std::vector<uint8> coverage;	// a Coverage per tile, empty when there's no selection map
+} TilePlan;
+
+// fit the largest aligned tiles of area into budget bytes of host and
+// plug-in memory
+void PlanTiles(TilePlan& plan, const VRect& area, int64 budget);
+// one request per tile of the host's own grid
+void PlanGridTiles(TilePlan& plan, VPoint tileOrigin, VPoint tileSize);
+int32 TileCount(const TilePlan& plan);
+VRect GetTileRect(const TilePlan& plan, int32 tile);
+Coverage GetTileCoverage(const TilePlan& plan, int32 tile);
+
+// the host's tile size and a corner of one of its tiles
+void GetHostTile(int32& width, int32& height, VPoint& origin);
+
+// first grid line at or before position
+inline int32 GridStart(int32 position, int32 origin, int32 step)
+{
+	int32 offset = (position - origin) % step;
+	if (offset < 0)
+		offset += step;
+	return position - offset;
+}
+
+// grid steps from start that it takes to reach end
+inline int32 CountSteps(int32 start, int32 end, int32 step)
+{
+	return end > start ? (end - start + step - 1) / step : 0;
+}
+
+#endif
+// end InvertTiles.h
@@ -0,0 +1,144 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertTiming.h"
+#include "InvertPipeline.h"
+#include "Logger.h"
+#include <string.h>
+#include <stdlib.h>
+
+//-------------------------------------------------------------------------------
+//
+// Preview timing
+//
+// Every proxy the dialog shows, whether UpdateProxyBuffer made it or the
+// background renderer handed it over, is timed here on PipelineClock, the
+// steady wall clock the renderer uses. When the dialog closes the frame rate
+// and the median and 99th percentile latency go to the log next to the
+// buffer counters, so a slower preview shows up from one run of the dialog
+// on any document, mode and depth. Nothing is written while the dialog is
+// up, a slider drag shouldn't wait on the log file.
+//
+// The frame rate is frames shown over the wall clock time from the first to
+// the last, which counts the time spent waiting on the user. Throughput is
+// frames over the time spent producing them, what the preview could keep up
+// with.
+//
+// test/InvertPreviewBench reads the same timing outside Photoshop. It runs
+// the dialog against a fake host and sweeps percent, disposition, proxy size
+// and depth, so a preview regression shows up without opening the dialog.
+//
+// Frames are only recorded on the thread that talks to the host, no lock.
+//
+//-------------------------------------------------------------------------------
+const int32 kTimingSamples = 512;
+
+static PreviewTiming gPreviewTiming;
+static double gTimingSamples[kTimingSamples];
+static PipelineClock::time_point gFirstFrameAt;
+static PipelineClock::time_point gLastFrameAt;
+
+void RecordPreviewFrame(double ms, int32 width, int32 height)
+{
+	if (ms < 0)
+		ms = 0;
+
+	gLastFrameAt = PipelineClock::now();
+	if (gPreviewTiming.frames == 0)
+		gFirstFrameAt = gLastFrameAt;
+
+	// the oldest sample makes room once the ring is full
+	gTimingSamples[gPreviewTiming.frames % kTimingSamples] = ms;
+	gPreviewTiming.frames++;
+	gPreviewTiming.pixels += (int64)width * height;
+	gPreviewTiming.totalMs += ms;
+	if (ms > gPreviewTiming.worstMs)
+		gPreviewTiming.worstMs = ms;
+}
+
+void RecordDroppedFrames(int32 count)
+{
+	if (count > 0)
+		gPreviewTiming.dropped += count;
+}
+
+static int CompareSamples(const void* a, const void* b)
+{
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// nearest rank, sorted holds count samples
+static double Percentile(const double* sorted, int32 count, int32 percent)
+{
+	int32 rank = (count * percent + 99) / 100;
+	if (rank < 1)
+		rank = 1;
+	return sorted[rank - 1];
+}
+
+void GetPreviewTiming(PreviewTiming& timing)
+{
+	timing = gPreviewTiming;
+	timing.framesPerSecond = 0;
+	timing.throughput = 0;
+	timing.p50Ms = 0;
+	timing.p99Ms = 0;
+	if (timing.frames == 0)
+		return;
+
+	// the first frame starts the clock, it doesn't end an interval
+	double shownMs = std::chrono::duration<double, std::milli>(gLastFrameAt - gFirstFrameAt).count();
+	if (timing.frames > 1 && shownMs > 0)
+		timing.framesPerSecond = (timing.frames - 1) * 1000.0 / shownMs;
+	if (timing.totalMs > 0)
+		timing.throughput = timing.frames * 1000.0 / timing.totalMs;
+
+	int32 count = timing.frames < kTimingSamples ? timing.frames : kTimingSamples;
+	double sorted[kTimingSamples];
+	memcpy(sorted, gTimingSamples, count * sizeof(double));
+	qsort(sorted, count, sizeof(double), CompareSamples);
+
+	timing.p50Ms = Percentile(sorted, count, 50);
+	timing.p99Ms = Percentile(sorted, count, 99);
+}
+
+void ResetPreviewTiming(void)
+{
+	memset(&gPreviewTiming, 0, sizeof(gPreviewTiming));
+}
+
+void LogPreviewTiming(void)
+{
+	PreviewTiming timing;
+	GetPreviewTiming(timing);
+
+	Logger logIt("Invert");
+	logIt.Write("Preview frames ", false);
+	logIt.Write(timing.frames, false);
+	logIt.Write(" dropped ", false);
+	logIt.Write(timing.dropped, false);
+	logIt.Write(" fps ", false);
+	logIt.Write(timing.framesPerSecond, false);
+	logIt.Write(" throughput fps ", false);
+	logIt.Write(timing.throughput, false);
+	logIt.Write(" p50 ms ", false);
+	logIt.Write(timing.p50Ms, false);
+	logIt.Write(" p99 ms ", false);
+	logIt.Write(timing.p99Ms, false);
+	logIt.Write(" worst ms ", false);
+	logIt.Write(timing.worstMs, false);
+	logIt.Write(" pixels ", false);
+	logIt.Write((double)timing.pixels, true);
+}
+
+// end InvertTiming.cpp
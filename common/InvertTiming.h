@@ -0,0 +1,45 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+#ifndef _INVERTTIMING_H
+#define _INVERTTIMING_H
+
+#include "Invert.h"
+
+// how quickly the dialog's preview has been redrawn since the last reset
+typedef struct PreviewTiming
+{
+	int32 frames;
+	int32 dropped;				// renderer frames replaced before they were shown
+	int64 pixels;				// proxy pixels inverted, all planes counted once
+	double totalMs;				// spent producing frames
+	double framesPerSecond;		// by the wall clock, first frame to last, 0 until there are two
+	double throughput;			// frames a second of totalMs, 0 until a frame has been timed
+	double p50Ms;
+	double p99Ms;
+	double worstMs;
+} PreviewTiming;
+
+// Note one preview frame of width by height pixels that took ms to produce,
+// timed on PipelineClock and shown now.
+void RecordPreviewFrame(double ms, int32 width, int32 height);
+
+// Note count renderer frames that a newer request made redundant.
+void RecordDroppedFrames(int32 count);
+
+// The percentiles are over the most recent frames only.
+void GetPreviewTiming(PreviewTiming& timing);
+void ResetPreviewTiming(void);
+
+// Write the timing to the log, once the dialog has closed.
+void LogPreviewTiming(void);
+
+#endif
+// end InvertTiming.h
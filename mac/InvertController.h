@@ -42,6 +42,8 @@ http://developer.apple.com/mac/library/documentation/UserExperience/Conceptual/P
 	
 }
 - (void) updateProxy;
+- (void) scheduleRefine;
+- (void) refineProxy;
 - (void) updateAmountValue;
 - (void) updateCursor;
 - (int) showWindow;
@@ -11,9 +11,19 @@
 
 #import "InvertController.h"
 #import "InvertProxyView.h"
+#import "InvertPreview.h"
 
 InvertController *gInvertController = NULL;
 
+// called on the preview renderer's thread, the view is redrawn on the main one
+static void PreviewReady(void* context)
+{
+	NSView* view = (NSView*)context;
+	dispatch_async(dispatch_get_main_queue(), ^{
+		[view setNeedsDisplay:YES];
+	});
+}
+
 /* Make sure this is unique to you and everyone you might encounter, search for
 "Preventing Name Conflicts" or use this link
 http://developer.apple.com/mac/library/documentation/UserExperience/Conceptual/PreferencePanes/Tasks/Conflicts.html
@@ -111,6 +121,7 @@ http://developer.apple.com/mac/library/documentation/UserExperience/Conceptual/P
 {
     [invertWindow makeKeyAndOrderFront:nil];
 	int b = [[NSApplication sharedApplication] runModalForWindow:invertWindow];
+	[NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(refineProxy) object:nil];
 	[invertWindow orderOut:self];
 	return b;
 }
@@ -174,7 +185,28 @@ http://developer.apple.com/mac/library/documentation/UserExperience/Conceptual/P
 {
 	CopyColor(gData->color, gData->colorArray[gParams->disposition]);
 	[(InvertProxyView*)proxyPreview setDispositionColor:gParams->disposition];
-	[proxyPreview setNeedsDisplay:YES];
+	// the view is redrawn when the renderer has the new frame
+	if (!RequestPreview(PreviewReady, proxyPreview))
+		[proxyPreview setNeedsDisplay:YES];
+}
+
+// read another row of a coarse proxy once the run loop is idle, the modal
+// loop only runs requests queued for its own mode
+- (void) scheduleRefine
+{
+	[NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(refineProxy) object:nil];
+	[self performSelector:@selector(refineProxy)
+			   withObject:nil
+			   afterDelay:0
+				  inModes:[NSArray arrayWithObject:NSModalPanelRunLoopMode]];
+}
+
+// drawRect schedules the next row for as long as StartProgressiveProxy says
+// there is one
+- (void) refineProxy
+{
+	RefineProxyInPreviewTask();
+	[self updateProxy];
 }
 
 - (void) updateCursor
@@ -33,6 +33,7 @@ http://developer.apple.com/mac/library/documentation/UserExperience/Conceptual/P
 }
 
 - (CGFloat)getCurrentScaleFactor;
+- (BOOL)getProxyPoint:(NSPoint)where h:(int32*)h v:(int32*)v;
 - (void)setDispositionColor:(int16)newColor;
 - (BOOL)isFlipped;
 
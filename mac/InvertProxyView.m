@@ -14,6 +14,9 @@
 #import "Invert.h"
 #import "FilterBigDocument.h"
 #import "InvertController.h"
+#import "InvertPreview.h"
+#import "InvertPyramid.h"
+#import "InvertDisplay.h"
 #import "PIProperties.h"
 
 extern void UpdateProxyBuffer(void);
@@ -129,6 +132,49 @@ http://developer.apple.com/mac/library/documentation/UserExperience/Conceptual/P
 		}
 	}
 
+- (BOOL)getProxyPoint:(NSPoint)where h:(int32*)h v:(int32*)v
+{
+	/*
+		The proxy is centered in the view in pixelData units, see drawRect
+	*/
+	CGFloat scaleFactor = [self getCurrentScaleFactor];
+	NSRect bounds = [self bounds];
+
+	int32 left = (int32)((bounds.size.width * scaleFactor - gData->proxyWidth) / 2);
+	int32 top = (int32)((bounds.size.height * scaleFactor - gData->proxyHeight) / 2);
+	if (left < 0)
+		left = 0;
+	if (top < 0)
+		top = 0;
+
+	*h = (int32)(where.x * scaleFactor) - left;
+	*v = (int32)(where.y * scaleFactor) - top;
+
+	return *h >= 0 && *v >= 0 && *h < gData->proxyWidth && *v < gData->proxyHeight;
+}
+
+// the wheel zooms about the pointer
+- (void)scrollWheel:(NSEvent *)theEvent
+{
+	NSPoint where = [self convertPoint:[theEvent locationInWindow] fromView:nil];
+	int32 h, v;
+
+	if ([theEvent deltaY] != 0 &&
+		[self getProxyPoint:where h:&h v:&v] &&
+		ZoomProxy([theEvent deltaY] > 0 ? 1 : -1, h, v))
+		[self setNeedsDisplay:YES];
+}
+
+// dragging pans a zoomed proxy, the image follows the pointer so the view
+// moves the other way
+- (void)mouseDragged:(NSEvent *)theEvent
+{
+	CGFloat scaleFactor = [self getCurrentScaleFactor];
+
+	if (PanProxy((int32)(-[theEvent deltaX] * scaleFactor), (int32)(-[theEvent deltaY] * scaleFactor)))
+		[self setNeedsDisplay:YES];
+}
+
 - (void)drawRect:(NSRect)rect 
 {
 
@@ -187,10 +233,20 @@ http://developer.apple.com/mac/library/documentation/UserExperience/Conceptual/P
 	pixelDataRect.right = gData->proxyRect.right;
 	
 	SetupFilterRecordForProxy();
-	CreateProxyBuffer();
-	CreateInvertBuffer(gData->proxyWidth, gData->proxyHeight);
-	ResetProxyBuffer();
-	UpdateProxyBuffer();
+
+	// a finished frame from the preview renderer is already inverted, any
+	// other redraw builds the proxy here. A big view starts out coarse and is
+	// refined a row of tiles per idle pass until it is whole.
+	Boolean framed = TakePreviewFrame();
+	if (!framed)
+		CreateProxyBuffer();
+	if (StartProgressiveProxy())
+		[gInvertController scheduleRefine];
+	if (!framed)
+	{
+		ResetProxyBuffer();
+		UpdateProxyBuffer();
+	}
 	
 	// Note: buffer width and height are in pixelData space
 	short bufferHeight = gData->proxyHeight;
@@ -312,8 +368,51 @@ http://developer.apple.com/mac/library/documentation/UserExperience/Conceptual/P
 	short logicalDstRow = pixelDataDstRow / scaleFactor;
 	short logicalDstCol = pixelDataDstCol / scaleFactor;
 	
-	if (gFilterRecord->displayPixels != NULL)
-		(*(gFilterRecord->displayPixels)) (&outMap, &logicalSrcRect, logicalDstRow, logicalDstCol, &windowContext);
+	// the display cache is already in the screen's layout, redraws that don't
+	// change the proxy reuse it without converting again
+	Boolean cached = UpdateProxyDisplay(&windowContext.fScreenRect);
+	if (cached && gData->proxyDisplayMonitor)
+	{
+		// converted for this monitor already, a plain blit
+		CGColorSpaceRef space = CGColorSpaceCreateDeviceRGB();
+		CGDataProviderRef provider = CGDataProviderCreateWithData(NULL, 
+																  gData->proxyDisplay, 
+																  (size_t)bufferWidth * bufferHeight * 4, 
+																  NULL);
+		CGImageRef image = CGImageCreate(bufferWidth, 
+										 bufferHeight, 
+										 8, 
+										 32, 
+										 (size_t)bufferWidth * 4, 
+										 space, 
+										 kCGImageAlphaNoneSkipFirst | kCGBitmapByteOrder32Little, 
+										 provider, 
+										 NULL, 
+										 false, 
+										 kCGRenderingIntentDefault);
+		CGRect where = CGRectMake(logicalDstCol, 
+								  logicalDstRow, 
+								  bufferWidth / scaleFactor, 
+								  bufferHeight / scaleFactor);
+
+		// the view is flipped and CGContextDrawImage draws bottom up
+		CGContextSaveGState(cgContext);
+		CGContextTranslateCTM(cgContext, 0, CGRectGetMinY(where) + CGRectGetMaxY(where));
+		CGContextScaleCTM(cgContext, 1, -1);
+		CGContextDrawImage(cgContext, where, image);
+		CGContextRestoreGState(cgContext);
+
+		CGImageRelease(image);
+		CGDataProviderRelease(provider);
+		CGColorSpaceRelease(space);
+	}
+	else
+	{
+		if (cached)
+			GetProxyDisplayMap(outMap);
+		if (gFilterRecord->displayPixels != NULL)
+			(*(gFilterRecord->displayPixels)) (&outMap, &logicalSrcRect, logicalDstRow, logicalDstCol, &windowContext);
+	}
 
 	[gInvertController updateCursor];
 }
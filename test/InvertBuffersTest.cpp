@@ -0,0 +1,121 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertTestHost.h"
+#include "InvertBuffers.h"
+#include <stdio.h>
+
+//-------------------------------------------------------------------------------
+//
+// Buffer test
+//
+// A dialog dragged back and forth between a 4K and an HD monitor asks for
+// the proxy at two sizes in turn. Once the proxy buffers have grown to the
+// larger one, going back to either size has to reuse them, by the plug-in's
+// counters and by what the host's bufferProcs were asked for. Once
+// DeleteProxyBuffer has run every buffer has to be back with the host.
+//
+//-------------------------------------------------------------------------------
+const int32 kSwitches = 6;
+
+// the proxy item on a 4K monitor and on an HD one
+const int16 kUltraWidth = 3840;
+const int16 kUltraHeight = 2160;
+const int16 kHDWidth = 1920;
+const int16 kHDHeight = 1080;
+
+static int32 gFailures = 0;
+
+static void Check(bool passed, const char* what)
+{
+	printf("%s %s\n", passed ? "ok  " : "FAIL", what);
+	if (!passed)
+		gFailures++;
+}
+
+static void SizeProxy(int32 proxy, Boolean show)
+{
+	int16 width = proxy % 2 ? kUltraWidth : kHDWidth;
+	int16 height = proxy % 2 ? kUltraHeight : kHDHeight;
+	if (show)
+	{
+		ShowTestProxy(width, height);
+		PaintTestProxy(0, 0, 0, height);
+		return;
+	}
+
+	gData->proxyRect.left = 0;
+	gData->proxyRect.top = 0;
+	gData->proxyRect.right = width;
+	gData->proxyRect.bottom = height;
+	SetupFilterRecordForProxy();
+	CreateProxyBuffer();
+}
+
+// HD, then 4K, which grows the buffers, then back and forth with no more
+// allocations, by the plug-in's count and the host's
+static void Alternate(TestHost& host, Boolean show, const char* what)
+{
+	char line[128];
+
+	SizeProxy(0, show);
+	SizeProxy(1, show);
+	Check(*gResult == noErr && gData->proxyBuffer != NULL, what);
+
+	BufferCounters grown;
+	GetBufferCounters(grown);
+	int32 hostAllocations = host.bufferAllocations;
+
+	for (int32 proxy = 2; proxy < 2 + kSwitches; proxy++)
+		SizeProxy(proxy, show);
+
+	BufferCounters after;
+	GetBufferCounters(after);
+	snprintf(line, sizeof(line), "%s: no allocations after the first grow (%d then %d)",
+			 what, grown.allocations, after.allocations);
+	Check(*gResult == noErr && after.allocations == grown.allocations &&
+		  after.frees == grown.frees && after.reuses > grown.reuses, line);
+	Check(host.bufferAllocations == hostAllocations, "host asked for nothing new");
+
+	DeleteProxyBuffer();
+
+	GetBufferCounters(after);
+	snprintf(line, sizeof(line), "%s: counts balance (%d allocated, %d freed, %d live)",
+			 what, after.allocations, after.frees, after.live);
+	Check(after.live == 0 && after.liveBytes == 0 && after.allocations == after.frees, line);
+	Check(host.buffersLive == 0 && host.bufferBytesLive == 0 &&
+		  host.bufferAllocations == host.bufferFrees, "host has every buffer back");
+}
+
+static Boolean BuffersDialog(TestHost& host)
+{
+	// CreateProxyBuffer on its own, then the whole proxy, source cache and
+	// display cache included
+	Alternate(host, false, "proxy buffer");
+	ResetBufferCounters();
+	Alternate(host, true, "shown proxy");
+	return false;
+}
+
+int main(void)
+{
+	TestHost host;
+	StartTestHost(host, kUltraWidth, kUltraHeight, 3, 8, plugInModeRGBColor);
+
+	int16 result = RunTestPlugIn(host, BuffersDialog);
+	Check(result == userCanceledErr, "dialog cancelled");
+	Check(host.buffersLive == 0, "nothing left with the host");
+
+	StopTestHost(host);
+	return gFailures ? 1 : 0;
+}
+
+// end InvertBuffersTest.cpp
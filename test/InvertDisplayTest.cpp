@@ -0,0 +1,173 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertTestHost.h"
+#include "InvertDisplay.h"
+#include <stdio.h>
+#include <string.h>
+
+//-------------------------------------------------------------------------------
+//
+// Display test
+//
+// The dialog's paint path, UpdateProxyDisplay, GetProxyDirtyRows and
+// displayPixels, driven against the test host's screen. A redraw of the same
+// proxy generation has to leave the RGBA cache alone and ask the host for
+// nothing new, and a paint of part of the window has to copy those rows and
+// no others. A parameter change has to rebuild the cache.
+//
+//-------------------------------------------------------------------------------
+const uint8 kUntouched = 0x5A;		// screen bytes displayPixels hasn't written
+
+static int32 gFailures = 0;
+
+static void Check(bool passed, const char* what)
+{
+	printf("%s %s\n", passed ? "ok  " : "FAIL", what);
+	if (!passed)
+		gFailures++;
+}
+
+static void ClearScreen(TestHost& host)
+{
+	memset(&host.screen[0], kUntouched, host.screen.size());
+}
+
+static const uint8* ScreenPixel(TestHost& host, int32 row, int32 col)
+{
+	return &host.screen[((size_t)row * host.screenWidth + col) * 4];
+}
+
+static const uint8* CachePixel(int32 row, int32 col)
+{
+	return (const uint8*)gData->proxyDisplay + ((size_t)row * gData->proxyWidth + col) * 4;
+}
+
+// screen rows first to last, drawn from top, hold the cache's rows
+static bool ScreenShowsCache(TestHost& host, int32 top, int32 first, int32 last)
+{
+	for (int32 y = first; y < last; y++)
+		for (int32 x = 0; x < gData->proxyWidth; x++)
+			if (memcmp(ScreenPixel(host, top + y, x), CachePixel(y, x), 3) != 0)
+				return false;
+	return true;
+}
+
+// screen rows outside first to last, drawn from top, are as cleared
+static bool ScreenUntouchedOutside(TestHost& host, int32 top, int32 first, int32 last)
+{
+	for (int32 row = 0; row < host.screenHeight; row++)
+	{
+		if (row >= top + first && row < top + last)
+			continue;
+		for (int32 x = 0; x < host.screenWidth * 4; x++)
+			if (host.screen[(size_t)row * host.screenWidth * 4 + x] != kUntouched)
+				return false;
+	}
+	return true;
+}
+
+// the cache is RGBA of the three proxy planes
+static bool CacheShowsProxy(void)
+{
+	const uint8* proxy = (const uint8*)gData->proxyBuffer;
+	for (int32 y = 0; y < gData->proxyHeight; y++)
+		for (int32 x = 0; x < gData->proxyWidth; x++)
+			for (int32 c = 0; c < 3; c++)
+				if (CachePixel(y, x)[c] != proxy[gData->proxyPlaneSize * c + y * gData->proxyWidth + x])
+					return false;
+	return true;
+}
+
+static Boolean DisplayDialog(TestHost& host)
+{
+	host.screenWidth = 400;
+	host.screenHeight = 300;
+	host.screen.resize((size_t)host.screenWidth * host.screenHeight * 4);
+	ClearScreen(host);
+
+	gParams->percent = 100;
+	ShowTestProxy((int16)host.screenWidth, (int16)host.screenHeight);
+	Check(*gResult == noErr && gData->proxyBuffer != NULL, "proxy shown");
+	if (gData->proxyBuffer == NULL)
+		return false;
+
+	int32 height = gData->proxyHeight;
+
+	// the first paint builds the cache and copies all of it
+	Check(PaintTestProxy(0, 0, 0, host.screenHeight) != 0, "first paint");
+	Check(CacheShowsProxy(), "cache holds the proxy");
+	Check(host.displayCalls == 1 && host.displayRows == height, "first paint copies every row");
+	Check(ScreenShowsCache(host, 0, 0, height), "screen shows the cache");
+
+	// the same parameters again keep the generation and so the cache, which
+	// a byte written behind its back shows
+	uint32 generation = gData->proxyGeneration;
+	void* cache = gData->proxyDisplay;
+	int32 allocations = host.bufferAllocations;
+	ResetProxyBuffer();
+	UpdateProxyBuffer();
+	Check(gData->proxyGeneration == generation, "same parameters keep the generation");
+
+	uint8* marked = (uint8*)CachePixel(15, 7);
+	*marked ^= 0x5A;
+	uint8 mark = *marked;
+
+	ClearScreen(host);
+	host.displayCalls = 0;
+	host.displayRows = 0;
+	Check(PaintTestProxy(0, 0, 10, 20) != 0, "repaint");
+	Check(*marked == mark && gData->proxyDisplay == cache, "repaint keeps the cache");
+	Check(host.bufferAllocations == allocations, "repaint allocates nothing");
+	Check(host.displayCalls == 1 && host.displayRows == 10, "repaint copies the dirty rows");
+	Check(ScreenShowsCache(host, 0, 10, 20), "dirty rows are on screen");
+	Check(ScreenUntouchedOutside(host, 0, 10, 20), "other rows are left alone");
+
+	// a dirty range half above the proxy copies the part that overlaps it
+	ClearScreen(host);
+	host.displayRows = 0;
+	Check(PaintTestProxy(5, 0, 0, 8) != 0, "repaint across the top");
+	Check(host.displayRows == 3, "only rows on the proxy are copied");
+	Check(ScreenShowsCache(host, 5, 0, 3) && ScreenUntouchedOutside(host, 5, 0, 3),
+		  "top rows are on screen and nothing else");
+
+	// and one below it copies nothing
+	host.displayCalls = 0;
+	Check(PaintTestProxy(0, 0, height, host.screenHeight) != 0 && host.displayCalls == 0,
+		  "repaint below the proxy copies nothing");
+
+	// new parameters are a new generation and a rebuilt cache
+	gParams->percent = 50;
+	ResetProxyBuffer();
+	UpdateProxyBuffer();
+	Check(gData->proxyGeneration != generation, "new parameters start a generation");
+	ClearScreen(host);
+	Check(PaintTestProxy(0, 0, 0, host.screenHeight) != 0, "paint after the change");
+	Check(CacheShowsProxy(), "cache rebuilt from the proxy");
+	Check(ScreenShowsCache(host, 0, 0, height), "screen shows the new cache");
+
+	return false;
+}
+
+int main(void)
+{
+	TestHost host;
+	StartTestHost(host, 800, 600, 3, 8, plugInModeRGBColor);
+
+	int16 result = RunTestPlugIn(host, DisplayDialog);
+	Check(result == userCanceledErr, "dialog cancelled");
+	Check(host.buffersLive == 0, "proxy buffers given back");
+
+	StopTestHost(host);
+	return gFailures ? 1 : 0;
+}
+
+// end InvertDisplayTest.cpp
@@ -0,0 +1,181 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertKernels.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+//-------------------------------------------------------------------------------
+//
+// Kernel test
+//
+// Every instruction set compiled in and supported by this machine is held to
+// the scalar kernels bit for bit. VerifyInvertKernels covers the run, decide,
+// pack and convert kernels. On top of that each tile kernel is run twice on
+// the same data, once over the scalar table and once over the table under
+// test: every depth, masked and unmasked, all of the pixels and a percentage
+// of them, with odd widths, offsets and row padding so the vector tails and
+// misaligned starts are exercised. Both have to match the scalar run kernel
+// applied pixel by pixel. The whole buffer is compared, padding included, so
+// a write past the end of a row shows up too.
+//
+//-------------------------------------------------------------------------------
+const int32 kTileHeight = 3;
+const int32 kRowPadding = 3;		// samples after each row, keeps rows misaligned
+
+static const int32 kWidths[] = { 1, 2, 3, 7, 15, 16, 17, 31, 33, 63, 65, 127, 129, 257 };
+static const int32 kPlanes[] = { 1, 3, 4 };
+static const int16 kPercents[] = { 100, 1, 37, 99 };
+
+static uint32 gSeed = 0x2545F491;
+
+static uint8 NextByte(void)
+{
+	gSeed = gSeed * 1664525 + 1013904223;
+	return (uint8)(gSeed >> 24);
+}
+
+// runs of unselected, selected and partly selected pixels, long enough for
+// the vector span finders and short enough to split them
+static void FillMask(std::vector<uint8>& mask)
+{
+	size_t m = 0;
+	while (m < mask.size())
+	{
+		int32 kind = NextByte() % 3;
+		int32 run = 1 + NextByte() % 80;
+		for (int32 r = 0; r < run && m < mask.size(); r++, m++)
+			mask[m] = kind == 0 ? 0 : kind == 1 ? 255 : (uint8)(1 + NextByte() % 254);
+	}
+}
+
+static bool SameTile(const InvertKernels& kernels,
+					 const InvertKernels& scalar,
+					 int32 depth,
+					 bool masked,
+					 int16 percent,
+					 int32 width,
+					 int32 planes,
+					 int32 offset)
+{
+	int32 sampleBytes = depth / 8;
+	int32 rowBytes = (width * planes + kRowPadding) * sampleBytes;
+	int32 maskRowBytes = width + kRowPadding;
+	size_t bytes = (size_t)offset * sampleBytes + (size_t)rowBytes * kTileHeight;
+
+	std::vector<uint8> pattern(bytes);
+	for (size_t b = 0; b < bytes; b++)
+		pattern[b] = NextByte();
+
+	std::vector<uint8> mask((size_t)maskRowBytes * kTileHeight);
+	FillMask(mask);
+
+	InvertPick pick;
+	pick.seed = 0x1234 + width * 7 + planes;
+	pick.threshold = InvertThreshold(percent);
+	pick.left = offset * 5 + 1;
+	pick.top = width;
+	pick.step = 1 + offset % 3;
+	const InvertPick* picked = percent < 100 ? &pick : NULL;
+
+	// pixel by pixel with the scalar kernels, partly selected pixels are
+	// inverted in full like selected ones
+	std::vector<uint8> expected(pattern);
+	InvertRunProc run = GetInvertRunProc(scalar, depth);
+	for (int32 y = 0; y < kTileHeight; y++)
+		for (int32 x = 0; x < width; x++)
+		{
+			if (masked && mask[(size_t)y * maskRowBytes + x] == 0)
+				continue;
+			if (picked != NULL)
+			{
+				InvertMaskWord decision;
+				scalar.decide(pick, pick.left + x * pick.step, pick.top + y * pick.step, &decision, 1);
+				if ((decision & 1) == 0)
+					continue;
+			}
+			run(&expected[(size_t)offset * sampleBytes + (size_t)y * rowBytes + (size_t)x * planes * sampleBytes], planes);
+		}
+
+	std::vector<uint8> reference(pattern);
+	std::vector<uint8> actual(pattern);
+	InvertTileProc tile = GetInvertTileProc(depth, masked);
+	tile(scalar, &reference[offset * sampleBytes], rowBytes,
+		 masked ? &mask[0] : NULL, maskRowBytes, width, kTileHeight, planes, picked);
+	tile(kernels, &actual[offset * sampleBytes], rowBytes,
+		 masked ? &mask[0] : NULL, maskRowBytes, width, kTileHeight, planes, picked);
+
+	if (expected == reference && expected == actual)
+		return true;
+
+	printf("  %s tile differs: depth %d %s percent %d width %d planes %d offset %d\n",
+		   InvertISAName(kernels.isa), depth, masked ? "masked" : "unmasked",
+		   percent, width, planes, offset);
+	return false;
+}
+
+static int32 TestTiles(const InvertKernels& kernels, const InvertKernels& scalar)
+{
+	int32 failures = 0;
+	int32 tiles = 0;
+	for (int32 depth = 8; depth <= 32; depth *= 2)
+		for (int32 masked = 0; masked < 2; masked++)
+			for (size_t p = 0; p < sizeof(kPercents) / sizeof(kPercents[0]); p++)
+				for (size_t w = 0; w < sizeof(kWidths) / sizeof(kWidths[0]); w++)
+					for (size_t n = 0; n < sizeof(kPlanes) / sizeof(kPlanes[0]); n++)
+						for (int32 offset = 0; offset < 4; offset++)
+						{
+							tiles++;
+							if (!SameTile(kernels, scalar, depth, masked != 0,
+										  kPercents[p], kWidths[w], kPlanes[n], offset))
+								failures++;
+						}
+	printf("%s %s tiles (%d tiles, %d differ)\n", failures ? "FAIL" : "ok  ",
+		   InvertISAName(kernels.isa), tiles, failures);
+	return failures;
+}
+
+int main(void)
+{
+	InvertKernels scalar;
+	SelectInvertKernels(scalar, isaScalar);
+
+	InvertISA best = DetectInvertISA();
+	int32 failures = 0;
+	for (int32 isa = isaScalar; isa <= isaAVX512; isa++)
+	{
+		if (isa > best)
+		{
+			printf("skip %s, not supported here\n", InvertISAName((InvertISA)isa));
+			continue;
+		}
+
+		InvertKernels kernels;
+		SelectInvertKernels(kernels, (InvertISA)isa);
+		if (kernels.isa != isa)
+		{
+			printf("skip %s, not compiled in\n", InvertISAName((InvertISA)isa));
+			continue;
+		}
+
+		bool verified = VerifyInvertKernels(kernels);
+		printf("%s %s kernels\n", verified ? "ok  " : "FAIL", InvertISAName(kernels.isa));
+		if (!verified)
+			failures++;
+
+		failures += TestTiles(kernels, scalar);
+	}
+
+	return failures ? 1 : 0;
+}
+
+// end InvertKernelsTest.cpp
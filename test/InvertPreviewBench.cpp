@@ -0,0 +1,129 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertTestHost.h"
+#include "InvertTiming.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//-------------------------------------------------------------------------------
+//
+// Preview benchmark
+//
+// How fast the dialog's preview reacts, measured without Photoshop. The
+// dialog runs against the test host, and for each depth, proxy size and
+// disposition the proxy is set up with SetupFilterRecordForProxy and redrawn
+// with ResetProxyBuffer and UpdateProxyBuffer while percent sweeps the way
+// a slider drag does. Each line is the plug-in's own PreviewTiming for that
+// sweep: frames a second and the median and 99th percentile latency.
+//
+// The first argument is the number of frames per sweep. ctest runs a short
+// sweep that only checks every case works, compare timings from full runs
+// on the same machine.
+//
+//-------------------------------------------------------------------------------
+const int32 kDefaultFrames = 200;
+const int32 kDocumentWidth = 2400;
+const int32 kDocumentHeight = 1800;
+
+typedef struct BenchDepth
+{
+	int32 depth;
+	int16 imageMode;
+} BenchDepth;
+
+static const BenchDepth kDepths[] = {
+	{ 8, plugInModeRGBColor },
+	{ 16, plugInModeRGB48 },
+	{ 32, plugInModeRGB96 }
+};
+
+// proxy items, the dialog's and a large one at 200%
+static const int16 kProxySizes[][2] = { { 200, 150 }, { 400, 300 }, { 800, 600 } };
+
+static const int16 kDispositions[] = { 0, 1, 2, 3 };
+
+// what a drag across the percent slider hands UpdateProxyBuffer
+static const int16 kPercents[] = { 1, 5, 10, 25, 40, 50, 60, 75, 90, 99, 100 };
+
+static int32 gFrames = kDefaultFrames;
+static int32 gFailures = 0;
+
+static Boolean BenchDialog(TestHost& host)
+{
+	for (size_t s = 0; s < sizeof(kProxySizes) / sizeof(kProxySizes[0]); s++)
+	{
+		gData->proxyRect.left = 0;
+		gData->proxyRect.top = 0;
+		gData->proxyRect.right = kProxySizes[s][0];
+		gData->proxyRect.bottom = kProxySizes[s][1];
+		SetupFilterRecordForProxy();
+		CreateProxyBuffer();
+
+		for (size_t d = 0; d < sizeof(kDispositions) / sizeof(kDispositions[0]); d++)
+		{
+			gParams->disposition = kDispositions[d];
+			ResetPreviewTiming();
+
+			for (int32 frame = 0; frame < gFrames; frame++)
+			{
+				gParams->percent = kPercents[frame % (sizeof(kPercents) / sizeof(kPercents[0]))];
+				ResetProxyBuffer();
+				UpdateProxyBuffer();
+			}
+
+			PreviewTiming timing;
+			GetPreviewTiming(timing);
+			if (*gResult != noErr || timing.frames != gFrames)
+			{
+				printf("FAIL depth %d proxy %dx%d disposition %d: %d of %d frames, result %d\n",
+					   host.depth, gData->proxyWidth, gData->proxyHeight, kDispositions[d],
+					   timing.frames, gFrames, *gResult);
+				gFailures++;
+				return false;
+			}
+
+			printf("%5d  %4dx%-4d  %11d  %6d  %8.1f  %10.1f  %7.3f  %7.3f\n",
+				   host.depth, gData->proxyWidth, gData->proxyHeight, kDispositions[d],
+				   timing.frames, timing.framesPerSecond, timing.throughput,
+				   timing.p50Ms, timing.p99Ms);
+		}
+	}
+	return false;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1)
+		gFrames = atoi(argv[1]);
+	if (gFrames < 1)
+		gFrames = 1;
+
+	printf("document %dx%d RGB, %d frames a sweep\n", kDocumentWidth, kDocumentHeight, gFrames);
+	printf("depth  proxy      disposition  frames       fps  throughput   p50 ms   p99 ms\n");
+
+	for (size_t d = 0; d < sizeof(kDepths) / sizeof(kDepths[0]); d++)
+	{
+		TestHost host;
+		StartTestHost(host, kDocumentWidth, kDocumentHeight, 3, kDepths[d].depth, kDepths[d].imageMode);
+		int16 result = RunTestPlugIn(host, BenchDialog);
+		if (result != userCanceledErr)
+		{
+			printf("FAIL depth %d: dialog result %d\n", kDepths[d].depth, result);
+			gFailures++;
+		}
+		StopTestHost(host);
+	}
+
+	return gFailures ? 1 : 0;
+}
+
+// end InvertPreviewBench.cpp
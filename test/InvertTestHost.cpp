@@ -0,0 +1,478 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertTestHost.h"
+#include "InvertDisplay.h"
+#include "FilterBigDocument.h"
+#include <stdlib.h>
+#include <string.h>
+
+DLLExport MACPASCAL void PluginMain(const int16 selector,
+									FilterRecordPtr filterRecord,
+									intptr_t* data,
+									int16* result);
+
+//-------------------------------------------------------------------------------
+//
+// Test host
+//
+// The callbacks below are what Photoshop does for a filter, cut down to one
+// document and no scratch disk. advanceState copies the requested planes of
+// inRect, sampled at inputRate, into a fresh interleaved buffer, and writes
+// the last outData back to the document first. Buffers and handles come
+// from the C heap and are counted, so a test can tell what the plug-in held.
+// The callbacks can't be handed a context, they find the host through
+// gTestHost, one host at a time.
+//
+//-------------------------------------------------------------------------------
+static TestHost* gTestHost = NULL;
+
+// last out rect handed out, written back on the next advanceState
+static VRect gOutRect;
+static int16 gOutLoPlane;
+static int16 gOutHiPlane;
+static std::vector<uint8> gOutData;
+
+static uint8* DocumentSample(TestHost& host, int32 plane, int32 x, int32 y)
+{
+	int32 sampleBytes = host.depth / 8;
+	size_t pixel = ((size_t)plane * host.height + y) * host.width + x;
+	return &host.document[pixel * sampleBytes];
+}
+
+static Boolean EmptyRect(const VRect& rect)
+{
+	return rect.right <= rect.left || rect.bottom <= rect.top;
+}
+
+// planes lo to hi of rect, rect in units of rate document pixels
+static void ReadPlanes(TestHost& host,
+					   std::vector<uint8>& buffer,
+					   const VRect& rect,
+					   int32 lo,
+					   int32 hi,
+					   int32 rate,
+					   int32& rowBytes)
+{
+	int32 sampleBytes = host.depth / 8;
+	int32 planes = hi - lo + 1;
+	int32 width = rect.right - rect.left;
+	int32 height = rect.bottom - rect.top;
+	rowBytes = width * planes * sampleBytes;
+	buffer.assign((size_t)rowBytes * height, 0);
+
+	for (int32 y = 0; y < height; y++)
+		for (int32 x = 0; x < width; x++)
+		{
+			int32 documentX = (rect.left + x) * rate;
+			int32 documentY = (rect.top + y) * rate;
+			if (documentX >= host.width || documentY >= host.height)
+				continue;
+			for (int32 p = 0; p < planes; p++)
+				memcpy(&buffer[(size_t)y * rowBytes + ((size_t)x * planes + p) * sampleBytes],
+					   DocumentSample(host, lo + p, documentX, documentY),
+					   sampleBytes);
+		}
+}
+
+static void WriteBackOut(TestHost& host)
+{
+	if (EmptyRect(gOutRect) || gOutData.empty())
+		return;
+
+	int32 sampleBytes = host.depth / 8;
+	int32 planes = gOutHiPlane - gOutLoPlane + 1;
+	int32 rowBytes = host.record.outRowBytes;
+	for (int32 y = gOutRect.top; y < gOutRect.bottom; y++)
+		for (int32 x = gOutRect.left; x < gOutRect.right; x++)
+			for (int32 p = 0; p < planes; p++)
+				memcpy(DocumentSample(host, gOutLoPlane + p, x, y),
+					   &gOutData[(size_t)(y - gOutRect.top) * rowBytes +
+								 ((size_t)(x - gOutRect.left) * planes + p) * sampleBytes],
+					   sampleBytes);
+}
+
+static MACPASCAL OSErr HostAdvanceState(void)
+{
+	TestHost& host = *gTestHost;
+	FilterRecord& record = host.record;
+	host.advanceCalls++;
+
+	WriteBackOut(host);
+
+	int32 inputRate = record.inputRate >> 16;
+	int32 maskRate = record.maskRate >> 16;
+	int32 sampleBytes = host.depth / 8;
+
+	VRect inRect = host.bigDocument.inRect32;
+	record.inData = NULL;
+	if (!EmptyRect(inRect))
+	{
+		ReadPlanes(host, host.inData, inRect, record.inLoPlane, record.inHiPlane,
+				   inputRate > 0 ? inputRate : 1, record.inRowBytes);
+		record.inData = &host.inData[0];
+		record.inColumnBytes = (record.inHiPlane - record.inLoPlane + 1) * sampleBytes;
+		record.inPlaneBytes = sampleBytes;
+	}
+
+	gOutRect = host.bigDocument.outRect32;
+	record.outData = NULL;
+	if (!EmptyRect(gOutRect))
+	{
+		gOutLoPlane = record.outLoPlane;
+		gOutHiPlane = record.outHiPlane;
+		ReadPlanes(host, gOutData, gOutRect, gOutLoPlane, gOutHiPlane, 1, record.outRowBytes);
+		record.outData = &gOutData[0];
+		record.outColumnBytes = (gOutHiPlane - gOutLoPlane + 1) * sampleBytes;
+		record.outPlaneBytes = sampleBytes;
+	}
+
+	VRect maskRect = host.bigDocument.maskRect32;
+	record.maskData = NULL;
+	if (record.haveMask && !EmptyRect(maskRect))
+	{
+		int32 rate = maskRate > 0 ? maskRate : 1;
+		int32 width = maskRect.right - maskRect.left;
+		int32 height = maskRect.bottom - maskRect.top;
+		host.maskData.assign((size_t)width * height, 0);
+		for (int32 y = 0; y < height; y++)
+			for (int32 x = 0; x < width; x++)
+			{
+				int32 documentX = (maskRect.left + x) * rate;
+				int32 documentY = (maskRect.top + y) * rate;
+				if (documentX < host.width && documentY < host.height)
+					host.maskData[(size_t)y * width + x] =
+						host.selection[(size_t)documentY * host.width + documentX];
+			}
+		record.maskData = &host.maskData[0];
+		record.maskRowBytes = width;
+	}
+
+	return noErr;
+}
+
+static MACPASCAL Boolean HostAbort(void)
+{
+	return false;
+}
+
+static MACPASCAL void HostProgress(int32 /* done */, int32 /* total */)
+{
+}
+
+static MACPASCAL OSErr HostColorServices(ColorServicesInfo* /* info */)
+{
+	return paramErr;
+}
+
+// the block starts with its size, the buffer follows
+const size_t kBlockHeader = 16;
+
+static MACPASCAL OSErr HostNewBuffer64(int64 size, BufferID* bufferID)
+{
+	TestHost& host = *gTestHost;
+	uint8* block = (uint8*)malloc(kBlockHeader + (size_t)size);
+	if (block == NULL)
+	{
+		*bufferID = NULL;
+		return memFullErr;
+	}
+	memcpy(block, &size, sizeof(size));
+	host.bufferAllocations++;
+	host.buffersLive++;
+	host.bufferBytesLive += size;
+	*bufferID = (BufferID)(block + kBlockHeader);
+	return noErr;
+}
+
+static MACPASCAL OSErr HostNewBuffer(int32 size, BufferID* bufferID)
+{
+	return HostNewBuffer64(size, bufferID);
+}
+
+static MACPASCAL Ptr HostLockBuffer(BufferID bufferID, Boolean /* moveHigh */)
+{
+	return (Ptr)bufferID;
+}
+
+static MACPASCAL void HostUnlockBuffer(BufferID /* bufferID */)
+{
+}
+
+static MACPASCAL void HostFreeBuffer(BufferID bufferID)
+{
+	TestHost& host = *gTestHost;
+	uint8* block = (uint8*)bufferID - kBlockHeader;
+	int64 size;
+	memcpy(&size, block, sizeof(size));
+	host.bufferFrees++;
+	host.buffersLive--;
+	host.bufferBytesLive -= size;
+	free(block);
+}
+
+// plenty, the tests that care about free space set their own
+static MACPASCAL int64 HostSpace64(void)
+{
+	return (int64)1 << 32;
+}
+
+static MACPASCAL int32 HostSpace(void)
+{
+	return 0x7FFFFFFF;
+}
+
+static MACPASCAL Handle HostNewHandle(int32 size)
+{
+	uint8* block = (uint8*)calloc(1, kBlockHeader + size);
+	memcpy(block, &size, sizeof(size));
+	Ptr* handle = (Ptr*)malloc(sizeof(Ptr));
+	*handle = (Ptr)(block + kBlockHeader);
+	return (Handle)handle;
+}
+
+static MACPASCAL void HostDisposeHandle(Handle handle)
+{
+	if (handle == NULL)
+		return;
+	free((uint8*)*handle - kBlockHeader);
+	free(handle);
+}
+
+static MACPASCAL int32 HostGetHandleSize(Handle handle)
+{
+	int32 size;
+	memcpy(&size, (uint8*)*handle - kBlockHeader, sizeof(size));
+	return size;
+}
+
+static MACPASCAL Ptr HostLockHandle(Handle handle, Boolean /* moveHigh */)
+{
+	return *handle;
+}
+
+static MACPASCAL void HostUnlockHandle(Handle /* handle */)
+{
+}
+
+// copy the map's srcRect onto the screen at dstRow, dstCol
+static MACPASCAL OSErr HostDisplayPixels(const PSPixelMap* source,
+									 const VRect* srcRect,
+									 int32 dstRow,
+									 int32 dstCol,
+									 void* /* platformContext */)
+{
+	TestHost& host = *gTestHost;
+	host.displayCalls++;
+	host.displayRows += srcRect->bottom - srcRect->top;
+
+	int32 colors = source->imageMode == plugInModeRGBColor ? 3 : 1;
+	for (int32 y = srcRect->top; y < srcRect->bottom; y++)
+	{
+		int32 screenY = dstRow + y - srcRect->top;
+		if (screenY < 0 || screenY >= host.screenHeight)
+			continue;
+		for (int32 x = srcRect->left; x < srcRect->right; x++)
+		{
+			int32 screenX = dstCol + x - srcRect->left;
+			if (screenX < 0 || screenX >= host.screenWidth)
+				continue;
+			const uint8* pixel = (const uint8*)source->baseAddr +
+								 (size_t)(y - source->bounds.top) * source->rowBytes +
+								 (size_t)(x - source->bounds.left) * source->colBytes;
+			uint8* screen = &host.screen[((size_t)screenY * host.screenWidth + screenX) * 4];
+			for (int32 c = 0; c < 3; c++)
+				screen[c] = pixel[(colors == 3 ? c : 0) * source->planeBytes];
+			screen[3] = 255;
+		}
+	}
+	return noErr;
+}
+
+void StartTestHost(TestHost& host,
+				   int32 width,
+				   int32 height,
+				   int32 planes,
+				   int32 depth,
+				   int16 imageMode)
+{
+	gTestHost = &host;
+
+	host.width = width;
+	host.height = height;
+	host.planes = planes;
+	host.depth = depth;
+
+	// a repeatable pattern, floats kept within 0 to 1
+	int32 sampleBytes = depth / 8;
+	size_t samples = (size_t)width * height * planes;
+	host.document.resize(samples * sampleBytes);
+	uint32 seed = 12345;
+	for (size_t s = 0; s < samples; s++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		if (depth == 32)
+		{
+			float value = (float)(seed >> 8) / (float)(1 << 24);
+			memcpy(&host.document[s * 4], &value, 4);
+		}
+		else
+		{
+			memcpy(&host.document[s * sampleBytes], &seed, sampleBytes);
+		}
+	}
+	host.selection.clear();
+
+	memset(&host.record, 0, sizeof(host.record));
+	memset(&host.bigDocument, 0, sizeof(host.bigDocument));
+	memset(&host.bufferProcs, 0, sizeof(host.bufferProcs));
+	memset(&host.handleProcs, 0, sizeof(host.handleProcs));
+
+	host.bufferProcs.bufferProcsVersion = kCurrentBufferProcsVersion;
+	host.bufferProcs.numBufferProcs = kCurrentBufferProcsCount;
+	host.bufferProcs.allocateProc = HostNewBuffer;
+	host.bufferProcs.lockProc = HostLockBuffer;
+	host.bufferProcs.unlockProc = HostUnlockBuffer;
+	host.bufferProcs.freeProc = HostFreeBuffer;
+	host.bufferProcs.spaceProc = HostSpace;
+	host.bufferProcs.allocateProc64 = HostNewBuffer64;
+	host.bufferProcs.spaceProc64 = HostSpace64;
+
+	host.handleProcs.handleProcsVersion = kCurrentHandleProcsVersion;
+	host.handleProcs.numHandleProcs = kCurrentHandleProcsCount;
+	host.handleProcs.newProc = HostNewHandle;
+	host.handleProcs.disposeProc = HostDisposeHandle;
+	host.handleProcs.getSizeProc = HostGetHandleSize;
+	host.handleProcs.lockProc = HostLockHandle;
+	host.handleProcs.unlockProc = HostUnlockHandle;
+
+	FilterRecord& record = host.record;
+	record.bufferProcs = &host.bufferProcs;
+	record.handleProcs = &host.handleProcs;
+	record.advanceState = HostAdvanceState;
+	record.abortProc = HostAbort;
+	record.progressProc = HostProgress;
+	record.colorServices = HostColorServices;
+	record.displayPixels = HostDisplayPixels;
+	record.bigDocumentData = &host.bigDocument;
+	record.planes = (int16)planes;
+	record.depth = (int16)depth;
+	record.imageMode = imageMode;
+	record.maxSpace = 0x7FFFFFFF;
+	record.maxSpace64 = (int64)1 << 32;
+	record.inTileWidth = record.outTileWidth = record.maskTileWidth = 256;
+	record.inTileHeight = record.outTileHeight = record.maskTileHeight = 256;
+	record.samplingSupport = hostSupportsIntegralSampling;
+	record.supportsPadding = true;
+
+	host.bigDocument.imageSize32.h = width;
+	host.bigDocument.imageSize32.v = height;
+	host.bigDocument.filterRect32.right = width;
+	host.bigDocument.filterRect32.bottom = height;
+
+	host.data = 0;
+	host.result = noErr;
+	host.dialog = NULL;
+	host.advanceCalls = 0;
+	host.bufferAllocations = 0;
+	host.bufferFrees = 0;
+	host.buffersLive = 0;
+	host.bufferBytesLive = 0;
+
+	host.screenWidth = 0;
+	host.screenHeight = 0;
+	host.screen.clear();
+	host.displayCalls = 0;
+	host.displayRows = 0;
+
+	gOutRect.left = gOutRect.top = gOutRect.right = gOutRect.bottom = 0;
+	gOutData.clear();
+}
+
+void StopTestHost(TestHost& host)
+{
+	HostDisposeHandle(host.record.parameters);
+	host.record.parameters = NULL;
+	HostDisposeHandle((Handle)host.data);
+	host.data = 0;
+	gTestHost = NULL;
+}
+
+int16 RunTestPlugIn(TestHost& host, TestDialogProc dialog)
+{
+	gTestHost = &host;
+	host.dialog = dialog;
+	host.result = noErr;
+
+	PluginMain(filterSelectorParameters, &host.record, &host.data, &host.result);
+	if (host.result == noErr)
+		PluginMain(filterSelectorPrepare, &host.record, &host.data, &host.result);
+	if (host.result == noErr)
+		PluginMain(filterSelectorStart, &host.record, &host.data, &host.result);
+
+	// Photoshop calls continue until the plug-in stops asking and then
+	// finish, only after a start that worked
+	while (host.result == noErr &&
+		   !(EmptyRect(host.bigDocument.inRect32) &&
+			 EmptyRect(host.bigDocument.outRect32) &&
+			 EmptyRect(host.bigDocument.maskRect32)))
+	{
+		HostAdvanceState();
+		PluginMain(filterSelectorContinue, &host.record, &host.data, &host.result);
+	}
+	if (host.result == noErr)
+	{
+		WriteBackOut(host);
+		PluginMain(filterSelectorFinish, &host.record, &host.data, &host.result);
+	}
+
+	return host.result;
+}
+
+Boolean RunTestDialog(void)
+{
+	TestHost& host = *gTestHost;
+	return host.dialog != NULL ? host.dialog(host) : false;
+}
+
+void ShowTestProxy(int16 width, int16 height)
+{
+	gData->proxyRect.left = 0;
+	gData->proxyRect.top = 0;
+	gData->proxyRect.right = width;
+	gData->proxyRect.bottom = height;
+
+	SetupFilterRecordForProxy();
+	CreateProxyBuffer();
+	if (*gResult == noErr)
+	{
+		ResetProxyBuffer();
+		UpdateProxyBuffer();
+	}
+}
+
+Boolean PaintTestProxy(int32 top, int32 left, int32 dirtyTop, int32 dirtyBottom)
+{
+	if (!UpdateProxyDisplay(NULL))
+		return false;
+
+	VRect srcRect;
+	if (GetProxyDirtyRows(top, dirtyTop, dirtyBottom, srcRect))
+	{
+		int32 first = srcRect.top - GetInRect().top;
+		PSPixelMap pixels;
+		GetProxyDisplayMap(pixels);
+		gFilterRecord->displayPixels(&pixels, &srcRect, top + first, left, NULL);
+	}
+	return true;
+}
+
+// end InvertTestHost.cpp
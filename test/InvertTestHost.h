@@ -0,0 +1,93 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+#ifndef _INVERTTESTHOST_H
+#define _INVERTTESTHOST_H
+
+#include "Invert.h"
+#include <vector>
+
+struct TestHost;
+
+// what DoUI runs, true for OK
+typedef Boolean (*TestDialogProc)(TestHost& host);
+
+// Photoshop as far as the headless tests need it: a planar document in
+// memory and the FilterRecord callbacks the plug-in calls on it, counting
+// what it is asked for.
+typedef struct TestHost
+{
+	int32 width;
+	int32 height;
+	int32 planes;
+	int32 depth;
+	std::vector<uint8> document;	// planes one after another, depth / 8 bytes a sample
+	std::vector<uint8> selection;	// width * height, empty for none
+
+	FilterRecord record;
+	BigDocumentStruct bigDocument;
+	BufferProcs bufferProcs;
+	HandleProcs handleProcs;
+	intptr_t data;
+	int16 result;
+	TestDialogProc dialog;
+
+	// what advanceState handed out
+	std::vector<uint8> inData;
+	std::vector<uint8> maskData;
+	int32 advanceCalls;
+
+	// what bufferProcs were asked for
+	int32 bufferAllocations;
+	int32 bufferFrees;
+	int32 buffersLive;
+	int64 bufferBytesLive;
+
+	// what displayPixels drew onto screen, RGBA
+	std::vector<uint8> screen;
+	int32 screenWidth;
+	int32 screenHeight;
+	int32 displayCalls;
+	int32 displayRows;
+} TestHost;
+
+// Set up a width by height document of planes at depth bits in imageMode,
+// filled with a repeatable pattern, with the whole of it to filter.
+void StartTestHost(TestHost& host,
+				   int32 width,
+				   int32 height,
+				   int32 planes,
+				   int32 depth,
+				   int16 imageMode);
+
+// Dispose of the handles the plug-in left with the host.
+void StopTestHost(TestHost& host);
+
+// Send the parameters, prepare and start selectors the way Photoshop does
+// for a filter run with a dialog. DoUI runs dialog with the plug-in's
+// globals set up. Returns the result of the start selector, userCanceledErr
+// when the dialog returned false.
+int16 RunTestPlugIn(TestHost& host, TestDialogProc dialog);
+
+// DoUI's side, runs the dialog RunTestPlugIn was given.
+Boolean RunTestDialog(void);
+
+// Size the proxy and draw its first frame, what the dialogs do when they
+// open or change size.
+void ShowTestProxy(int16 width, int16 height);
+
+// Paint the proxy rows that fall between dirtyTop and dirtyBottom of the
+// screen, the proxy drawn with its top left at top, left. This is the
+// dialogs' paint with displayPixels and the display cache. Returns false
+// when the cache couldn't be made.
+Boolean PaintTestProxy(int32 top, int32 left, int32 dirtyTop, int32 dirtyBottom);
+
+#endif
+// end InvertTestHost.h
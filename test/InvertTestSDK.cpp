@@ -0,0 +1,207 @@
+// ADOBE SYSTEMS INCORPORATED
+// Copyright  1993 - 2002 Adobe Systems Incorporated
+// All Rights Reserved
+//
+// NOTICE:  Adobe permits you to use, modify, and distribute this
+// file in accordance with the terms of the Adobe license agreement
+// accompanying it.  If you have received this file from a source
+// other than Adobe, then your use, modification, or distribution
+// of it requires the prior written permission of Adobe.
+//-------------------------------------------------------------------------------
+
+#include "InvertTestHost.h"
+#include "InvertUI.h"
+#include "FilterBigDocument.h"
+#include "Logger.h"
+#include "Timer.h"
+#include <time.h>
+
+//-------------------------------------------------------------------------------
+//
+// SDK stand-ins
+//
+// The plug-in projects compile PIUtilities, FilterBigDocument, Logger and
+// Timer from the SDK's common sources, which this tree doesn't carry, and
+// one of the platform UIs. The tests link these instead. They do what the
+// SDK routines do for the calls the plug-in makes, no more. The log goes
+// nowhere and DoUI runs whatever dialog the test has put up.
+//
+//-------------------------------------------------------------------------------
+VRect GetFilterRect(void)
+{
+	return gFilterRecord->bigDocumentData->filterRect32;
+}
+
+VRect GetInRect(void)
+{
+	return gFilterRecord->bigDocumentData->inRect32;
+}
+
+VRect GetOutRect(void)
+{
+	return gFilterRecord->bigDocumentData->outRect32;
+}
+
+VRect GetMaskRect(void)
+{
+	return gFilterRecord->bigDocumentData->maskRect32;
+}
+
+void SetInRect(VRect inRect)
+{
+	gFilterRecord->bigDocumentData->inRect32 = inRect;
+}
+
+void SetOutRect(VRect outRect)
+{
+	gFilterRecord->bigDocumentData->outRect32 = outRect;
+}
+
+void SetMaskRect(VRect maskRect)
+{
+	gFilterRecord->bigDocumentData->maskRect32 = maskRect;
+}
+
+int16 CSPlanesFromMode(const int16 imageMode, const int16 currPlanes)
+{
+	switch (imageMode)
+	{
+		case plugInModeRGBColor:
+		case plugInModeRGB48:
+		case plugInModeRGB96:
+		case plugInModeLabColor:
+		case plugInModeLab48:
+			return 3;
+		case plugInModeCMYKColor:
+		case plugInModeCMYK64:
+			return 4;
+		case plugInModeMultichannel:
+		case plugInModeDeepMultichannel:
+			return currPlanes;
+		default:
+			break;
+	}
+	return 1;
+}
+
+int16 CSModeToSpace(const int16 imageMode)
+{
+	switch (imageMode)
+	{
+		case plugInModeRGBColor:
+		case plugInModeRGB48:
+		case plugInModeRGB96:
+			return plugIncolorServicesRGBSpace;
+		case plugInModeCMYKColor:
+		case plugInModeCMYK64:
+			return plugIncolorServicesCMYKSpace;
+		case plugInModeLabColor:
+		case plugInModeLab48:
+			return plugIncolorServicesLabSpace;
+		default:
+			break;
+	}
+	return plugIncolorServicesGraySpace;
+}
+
+int64 HostBufferSpace64(BufferProcs* procs)
+{
+	if (procs == NULL)
+		return 0;
+	if (procs->numBufferProcs >= 8 && procs->spaceProc64 != NULL)
+		return procs->spaceProc64();
+	if (procs->spaceProc != NULL)
+		return procs->spaceProc();
+	return 0;
+}
+
+OSErr HostAllocateBuffer64(BufferProcs* procs, const int64 inSize, BufferID* outBufferID)
+{
+	*outBufferID = 0;
+	if (procs == NULL)
+		return memFullErr;
+	if (procs->numBufferProcs >= 7 && procs->allocateProc64 != NULL)
+		return procs->allocateProc64(inSize, outBufferID);
+	if (inSize > 0x7FFFFFFF)
+		return memFullErr;
+	return procs->allocateProc((int32)inSize, outBufferID);
+}
+
+Boolean HostChannelPortAvailable(ChannelPortProcs* procs, Boolean* outNewerVersion)
+{
+	if (outNewerVersion != NULL)
+		*outNewerVersion = false;
+	return procs != NULL && procs->numChannelPortProcs > 0;
+}
+
+Boolean DoUI(void)
+{
+	return RunTestDialog();
+}
+
+void DoAbout(void)
+{
+}
+
+Logger::Logger(const char* /* pluginName */)
+{
+}
+
+Logger::~Logger()
+{
+}
+
+void Logger::Write(const char* /* message */, const bool /* endOfLine */)
+{
+}
+
+void Logger::Write(const int32 /* message */, const bool /* endOfLine */)
+{
+}
+
+void Logger::Write(const double /* message */, const bool /* endOfLine */)
+{
+}
+
+void Logger::Write(const string& /* message */, const bool /* endOfLine */)
+{
+}
+
+// clock() like the SDK's Timer
+static double NowMilliseconds(void)
+{
+	return (double)clock() * 1000.0 / CLOCKS_PER_SEC;
+}
+
+Timer::Timer()
+{
+	Start();
+}
+
+Timer::~Timer()
+{
+}
+
+void Timer::Start(void)
+{
+	startTime = NowMilliseconds();
+	endTime = startTime;
+}
+
+void Timer::Stop(void)
+{
+	endTime = NowMilliseconds();
+}
+
+double Timer::GetTime(void)
+{
+	return endTime - startTime;
+}
+
+double Timer::GetElapsed(void)
+{
+	Stop();
+	return GetTime();
+}
+
+// end InvertTestSDK.cpp
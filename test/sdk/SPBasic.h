@@ -0,0 +1,20 @@
+// Stand-in for PICA's SPBasic.h so the plug-in sources compile for the headless tests.
+// Only what the Invert sources use is declared, none of it is real.
+#ifndef _TEST_SPBASIC_H
+#define _TEST_SPBASIC_H
+
+#include "SPTypes.h"
+#include <stddef.h>
+
+typedef struct SPBasicSuite
+{
+	SPErr (*AcquireSuite)(const char* name, int32_t version, const void** suite);
+	SPErr (*ReleaseSuite)(const char* name, int32_t version);
+	SPBoolean (*IsEqual)(const char* token1, const char* token2);
+	SPErr (*AllocateBlock)(size_t size, void** block);
+	SPErr (*FreeBlock)(void* block);
+	SPErr (*ReallocateBlock)(void* block, size_t newSize, void** newblock);
+	SPErr (*Undefined)(void);
+} SPBasicSuite;
+
+#endif
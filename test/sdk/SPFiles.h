@@ -0,0 +1,12 @@
+// Stand-in for PICA's SPFiles.h so the plug-in sources compile for the headless tests.
+// Only what the Invert sources use is declared, none of it is real.
+#ifndef _TEST_SPFILES_H
+#define _TEST_SPFILES_H
+
+#include "SPTypes.h"
+
+typedef struct SPPlatformFileSpecification { char path[260]; } SPPlatformFileSpecification;
+typedef struct SPPlatformFileSpecificationW { wchar_t* path; } SPPlatformFileSpecificationW;
+typedef SPPlatformFileSpecification SPPlatformFileSpec;
+
+#endif
@@ -0,0 +1,3 @@
+// Stand-in for PICA's SPMData.h so the plug-in sources compile for the headless tests.
+// Only what the Invert sources use is declared, none of it is real.
+#include "SPTypes.h"
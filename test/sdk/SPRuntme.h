@@ -0,0 +1,3 @@
+// Stand-in for PICA's SPRuntme.h so the plug-in sources compile for the headless tests.
+// Only what the Invert sources use is declared, none of it is real.
+typedef struct SPRuntimeSuite SPRuntimeSuite;
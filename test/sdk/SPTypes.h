@@ -0,0 +1,18 @@
+// Stand-in for PICA's SPTypes.h so the plug-in sources compile for the headless tests.
+// Only what the Invert sources use is declared, none of it is real.
+#ifndef _TEST_SPTYPES_H
+#define _TEST_SPTYPES_H
+
+#include <stdint.h>
+
+#define SPAPI
+#define kSPNoError 0
+#define kSPBadParameterError 'Parm'
+
+typedef int32_t SPErr;
+typedef unsigned char SPBoolean;
+typedef int32_t SPInt32;
+typedef uint32_t SPUInt32;
+typedef struct SPPlugin* SPPluginRef;
+
+#endif
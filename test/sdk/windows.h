@@ -0,0 +1,44 @@
+// Stand-in for the Windows SDK's windows.h so the plug-in sources compile for the headless tests.
+// Only what the Invert sources use is declared, none of it is real.
+#ifndef _TEST_WINDOWS_H
+#define _TEST_WINDOWS_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define __declspec(x)
+#define WINAPI
+#define CALLBACK
+#define MAX_PATH 260
+
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef uint32_t DWORD;
+typedef int BOOL;
+typedef unsigned int UINT;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef wchar_t WCHAR;
+typedef unsigned short ATOM;
+typedef char* LPSTR;
+typedef const char* LPCSTR;
+typedef void* LPVOID;
+typedef intptr_t INT_PTR;
+typedef intptr_t LPARAM;
+typedef uintptr_t WPARAM;
+typedef intptr_t LRESULT;
+typedef void* HANDLE;
+typedef void* HWND;
+typedef void* HDC;
+typedef void* HINSTANCE;
+typedef void* HMODULE;
+typedef void* HGLOBAL;
+typedef void* HBRUSH;
+typedef void* HICON;
+typedef void* HCURSOR;
+typedef void* HFONT;
+typedef void* HMENU;
+typedef struct { LONG left, top, right, bottom; } RECT;
+typedef struct { LONG x, y; } POINT;
+
+#endif
@@ -0,0 +1,3 @@
+// Stand-in for the Windows SDK's windowsx.h so the plug-in sources compile for the headless tests.
+// Only what the Invert sources use is declared, none of it is real.
+#include "windows.h"
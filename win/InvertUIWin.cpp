@@ -13,6 +13,9 @@
 
 #include "Invert.h"
 #include "InvertUI.h"
+#include "InvertPreview.h"
+#include "InvertPyramid.h"
+#include "InvertDisplay.h"
 #include "FilterBigDocument.h"
 
 //-------------------------------------------------------------------------------
@@ -22,9 +25,18 @@ void GetProxyItemRect(HWND hDlg);
 void PaintProxy(HWND hDlg);
 void UpdateProxyItem(HWND hDlg);
 void UpdateProxyItemAndRecord(HWND hDlg);
+void InvalidateProxyItem(HWND hDlg);
+void PreviewReady(void* context);
+BOOL GetProxyPoint(HWND hDlg, POINT where, int32& h, int32& v);
 void HandleDpiChanged(HWND hDlg, WPARAM wParam, LPARAM lParam);
 bool IsPerMonitorDPIEnabled();
 
+// posted by PreviewReady when the renderer has a frame for us
+const UINT kPreviewReadyMessage = WM_APP + 1;
+
+// reads another row of a coarse proxy while the dialog is otherwise idle
+const UINT_PTR kRefineTimer = 1;
+
 
 
 //-------------------------------------------------------------------------------
@@ -46,6 +58,7 @@ DLLExport BOOL WINAPI InvertProc(HWND hDlg,
 {
 	BOOL returnValue = TRUE;
 	int	item, cmd;
+	static POINT dragPoint;
 	switch (wMsg)
 	{
 		case WM_INITDIALOG:
@@ -82,8 +95,7 @@ DLLExport BOOL WINAPI InvertProc(HWND hDlg,
 				case kDCancel:
 					if (cmd == BN_CLICKED)
 					{
-						DeleteProxyBuffer();
-						DeleteInvertBuffer();
+						KillTimer(hDlg, kRefineTimer);
 						EndDialog(hDlg, item);
 						returnValue = TRUE;
 					}
@@ -128,6 +140,62 @@ DLLExport BOOL WINAPI InvertProc(HWND hDlg,
 			returnValue = TRUE;
 			break;
 
+		case kPreviewReadyMessage:
+			if (*gResult == noErr && TakePreviewFrame())
+				InvalidateProxyItem(hDlg);
+			break;
+
+		// WM_TIMER only comes when no input is waiting, so refining never
+		// holds up typing or dragging
+		case WM_TIMER:
+			if (wParam == kRefineTimer)
+			{
+				if (!RefineProxyInPreviewTask())
+					KillTimer(hDlg, kRefineTimer);
+				UpdateProxyItem(hDlg);
+			}
+			break;
+
+		// the wheel zooms about the pointer, dragging pans a zoomed proxy
+		case WM_MOUSEWHEEL:
+			{
+				POINT where = { (short)LOWORD(lParam), (short)HIWORD(lParam) };
+				int32 h, v;
+				ScreenToClient(hDlg, &where);
+				if (*gResult == noErr && GetProxyPoint(hDlg, where, h, v) &&
+					ZoomProxy(GET_WHEEL_DELTA_WPARAM(wParam) > 0 ? 1 : -1, h, v))
+					UpdateProxyItemAndRecord(hDlg);
+			}
+			break;
+
+		case WM_LBUTTONDOWN:
+			{
+				POINT where = { (short)LOWORD(lParam), (short)HIWORD(lParam) };
+				int32 h, v;
+				if (GetProxyPoint(hDlg, where, h, v))
+				{
+					dragPoint = where;
+					SetCapture(hDlg);
+				}
+			}
+			break;
+
+		case WM_MOUSEMOVE:
+			if (GetCapture() == hDlg)
+			{
+				POINT where = { (short)LOWORD(lParam), (short)HIWORD(lParam) };
+				// the image follows the pointer, so the view moves the other way
+				if (*gResult == noErr && PanProxy(dragPoint.x - where.x, dragPoint.y - where.y))
+					UpdateProxyItemAndRecord(hDlg);
+				dragPoint = where;
+			}
+			break;
+
+		case WM_LBUTTONUP:
+			if (GetCapture() == hDlg)
+				ReleaseCapture();
+			break;
+
 		case WM_DPICHANGED:
 			HandleDpiChanged(hDlg, wParam, lParam);
 			break;
@@ -167,29 +235,57 @@ Boolean DoUI(void)
 //
 // UpdateProxyItem
 //
-// Force the WM_PAINT message to the InvertProc routine.
+// Hand the new parameters to the preview renderer. PreviewReady tells us when
+// the frame is done and only then is the proxy repainted. Without a source
+// cache to render from it is drawn here instead.
 //
 //-------------------------------------------------------------------------------
 void UpdateProxyItem(HWND hDlg)
 {
-	RECT imageRect;
-
-	if (*gResult == noErr)
+	if (*gResult == noErr && !RequestPreview(PreviewReady, hDlg))
 	{
 		ResetProxyBuffer();
 		UpdateProxyBuffer();
-		GetWindowRect(GetDlgItem(hDlg, kDProxyItem), &imageRect);
-		ScreenToClient(hDlg, (LPPOINT)&imageRect);
-		ScreenToClient(hDlg, (LPPOINT)&(imageRect.right));
-		InvalidateRect(hDlg, &imageRect, FALSE);
+		InvalidateProxyItem(hDlg);
 	}
 }
 
+//-------------------------------------------------------------------------------
+//
+// PreviewReady
+//
+// Called on the renderer's thread, all it may do is post to the dialog.
+//
+//-------------------------------------------------------------------------------
+void PreviewReady(void* context)
+{
+	PostMessage((HWND)context, kPreviewReadyMessage, 0, 0);
+}
+
+//-------------------------------------------------------------------------------
+//
+// InvalidateProxyItem
+//
+// Force the WM_PAINT message to the InvertProc routine.
+//
+//-------------------------------------------------------------------------------
+void InvalidateProxyItem(HWND hDlg)
+{
+	RECT imageRect;
+
+	GetWindowRect(GetDlgItem(hDlg, kDProxyItem), &imageRect);
+	ScreenToClient(hDlg, (LPPOINT)&imageRect);
+	ScreenToClient(hDlg, (LPPOINT)&(imageRect.right));
+	InvalidateRect(hDlg, &imageRect, FALSE);
+}
+
 //-------------------------------------------------------------------------------
 //
 // UpdateProxyItemAndRecord
 //
-// Update ProxyItem size and plugin's global record.
+// Update ProxyItem size and plugin's global record. The first frame for a
+// size is drawn here so the dialog never opens on an empty proxy. A big view
+// starts out coarse and the refine timer fills in the rest.
 //
 //-------------------------------------------------------------------------------
 void UpdateProxyItemAndRecord(HWND hDlg)
@@ -197,11 +293,17 @@ void UpdateProxyItemAndRecord(HWND hDlg)
 	GetProxyItemRect(hDlg);
 	SetupFilterRecordForProxy();
 	CreateProxyBuffer();
-	CreateInvertBuffer(gData->proxyWidth, gData->proxyHeight);
-	UpdateProxyItem(hDlg);
+	if (*gResult == noErr)
+	{
+		if (StartProgressiveProxy())
+			SetTimer(hDlg, kRefineTimer, USER_TIMER_MINIMUM, NULL);
+		else
+			KillTimer(hDlg, kRefineTimer);
+		ResetProxyBuffer();
+		UpdateProxyBuffer();
+		InvalidateProxyItem(hDlg);
+	}
 }
-
-
 //-------------------------------------------------------------------------------
 //
 // GetProxyItemRect
@@ -225,6 +327,34 @@ void GetProxyItemRect(HWND hDlg)
 
 
 
+//-------------------------------------------------------------------------------
+//
+// GetProxyPoint
+//
+// Turn a point in client coordinates into proxy pixels, using the same
+// centering as PaintProxy. Returns false when the point is off the proxy.
+//
+//-------------------------------------------------------------------------------
+BOOL GetProxyPoint(HWND hDlg, POINT where, int32& h, int32& v)
+{
+	RECT wRect;
+	POINT mapOrigin;
+
+	GetWindowRect(GetDlgItem(hDlg, kDProxyItem), &wRect);
+	mapOrigin.x = 0;
+	mapOrigin.y = 0;
+	ClientToScreen(hDlg, &mapOrigin);
+
+	VRect inRect = GetInRect();
+	int32 width = inRect.right - inRect.left;
+	int32 height = inRect.bottom - inRect.top;
+
+	h = where.x - ((wRect.right + wRect.left - width) / 2 - mapOrigin.x);
+	v = where.y - ((wRect.bottom + wRect.top - height) / 2 - mapOrigin.y);
+
+	return h >= 0 && v >= 0 && h < width && v < height;
+}
+
 //-------------------------------------------------------------------------------
 //
 // PaintProxy
@@ -285,53 +415,106 @@ void PaintProxy(HWND hDlg)
 	FrameRect(hDC, &wRect, (HBRUSH)GetStockObject(BLACK_BRUSH));	
 	InflateRect(&wRect, -2, -2);
 	
-	// init the PSPixel map
-	pixels.version = 1;
-	pixels.bounds.top = inRect.top;
-	pixels.bounds.left = inRect.left;
-	pixels.bounds.bottom = inRect.bottom;
-	pixels.bounds.right = inRect.right;
-	pixels.imageMode = DisplayPixelsMode(gFilterRecord->imageMode);
-	pixels.rowBytes = gData->proxyWidth;
-	pixels.colBytes = 1;
-	pixels.planeBytes = gData->proxyPlaneSize;
-	pixels.baseAddr = gData->proxyBuffer;
-
-	pixels.mat = NULL;
-	pixels.masks = NULL;
-	pixels.maskPhaseRow = 0;
-	pixels.maskPhaseCol = 0;
-
-	// display the transparency information if it exists
-	if (gFilterRecord->isFloating != NULL) 
-	{
-		mask.next = NULL;
-		mask.maskData = gFilterRecord->maskData;
-		mask.rowBytes = gFilterRecord->maskRowBytes;
-		mask.colBytes = 1;
-		mask.maskDescription = kSimplePSMask;
-	
-		pixels.masks = &mask;
-	} 
-	else if ((gFilterRecord->inLayerPlanes != 0) && 
-		       (gFilterRecord->inTransparencyMask != 0)) 
+	// the display cache is already in the screen's layout, an expose only
+	// draws the rows it uncovered
+	VRect screenRect = itemBounds;
+	screenRect.left += mapOrigin.x;
+	screenRect.top += mapOrigin.y;
+	screenRect.right += mapOrigin.x;
+	screenRect.bottom += mapOrigin.y;
+
+	VRect srcRect;
+	if (UpdateProxyDisplay(&screenRect))
 	{
-		mask.next = NULL;
-		mask.maskData = ((int8 *) gData->proxyBuffer) + 
-			            gData->proxyPlaneSize *
-						CSPlanesFromMode(gFilterRecord->imageMode, 0);
-		mask.rowBytes = gData->proxyWidth;
-		mask.colBytes = 1;
-		mask.maskDescription = kSimplePSMask;
-	
-		pixels.masks = &mask;
+		if (GetProxyDirtyRows(itemBounds.top, ps.rcPaint.top, ps.rcPaint.bottom, srcRect))
+		{
+			int32 first = srcRect.top - inRect.top;
+			int32 rows = srcRect.bottom - srcRect.top;
+			if (gData->proxyDisplayMonitor)
+			{
+				// converted for this monitor already, a plain blit
+				BITMAPINFO info;
+				memset(&info, 0, sizeof(info));
+				info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+				info.bmiHeader.biWidth = gData->proxyWidth;
+				info.bmiHeader.biHeight = -rows;
+				info.bmiHeader.biPlanes = 1;
+				info.bmiHeader.biBitCount = 32;
+				info.bmiHeader.biCompression = BI_RGB;
+				SetDIBitsToDevice(hDC, 
+								  itemBounds.left, 
+								  itemBounds.top + first, 
+								  gData->proxyWidth, 
+								  rows, 
+								  0, 
+								  0, 
+								  0, 
+								  rows, 
+								  gData->proxyDisplay + first * gData->proxyWidth * 4, 
+								  &info, 
+								  DIB_RGB_COLORS);
+			}
+			else
+			{
+				GetProxyDisplayMap(pixels);
+				(gFilterRecord->displayPixels)(&pixels, 
+											   &srcRect, 
+											   itemBounds.top + first, 
+											   itemBounds.left, 
+											   (void*)hDC);
+			}
+		}
 	}
+	else
+	{
+		// init the PSPixel map
+		pixels.version = 1;
+		pixels.bounds.top = inRect.top;
+		pixels.bounds.left = inRect.left;
+		pixels.bounds.bottom = inRect.bottom;
+		pixels.bounds.right = inRect.right;
+		pixels.imageMode = DisplayPixelsMode(gFilterRecord->imageMode);
+		pixels.rowBytes = gData->proxyWidth;
+		pixels.colBytes = 1;
+		pixels.planeBytes = gData->proxyPlaneSize;
+		pixels.baseAddr = gData->proxyBuffer;
+
+		pixels.mat = NULL;
+		pixels.masks = NULL;
+		pixels.maskPhaseRow = 0;
+		pixels.maskPhaseCol = 0;
+
+		// display the transparency information if it exists
+		if (gFilterRecord->isFloating != NULL) 
+		{
+			mask.next = NULL;
+			mask.maskData = gFilterRecord->maskData;
+			mask.rowBytes = gFilterRecord->maskRowBytes;
+			mask.colBytes = 1;
+			mask.maskDescription = kSimplePSMask;
+		
+			pixels.masks = &mask;
+		} 
+		else if ((gFilterRecord->inLayerPlanes != 0) && 
+			       (gFilterRecord->inTransparencyMask != 0)) 
+		{
+			mask.next = NULL;
+			mask.maskData = ((int8 *) gData->proxyBuffer) + 
+				            gData->proxyPlaneSize *
+							CSPlanesFromMode(gFilterRecord->imageMode, 0);
+			mask.rowBytes = gData->proxyWidth;
+			mask.colBytes = 1;
+			mask.maskDescription = kSimplePSMask;
+		
+			pixels.masks = &mask;
+		}
 
-	(gFilterRecord->displayPixels)(&pixels, 
-		                           &pixels.bounds, 
-								   itemBounds.top, 
-								   itemBounds.left, 
-								   (void*)hDC);
+		(gFilterRecord->displayPixels)(&pixels, 
+			                           &pixels.bounds, 
+									   itemBounds.top, 
+									   itemBounds.left, 
+									   (void*)hDC);
+	}
 
 	EndPaint(hDlg, (LPPAINTSTRUCT) &ps);
 }